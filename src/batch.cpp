@@ -0,0 +1,274 @@
+constexpr size_t BATCH_BUFFER_SIZE = 1 << 20;
+constexpr size_t BATCH_CHUNK_SIZE = 256;
+
+// Matches batches of strings on 'thread_count' threads that share one table. Threads are started once and wait for the next batch between batches, each one has its own 'Matcher'. Strings of a batch are split into chunks, and a thread takes the next unprocessed chunk as soon as it's done with the previous one, so threads that got short strings don't stay idle. Results are stored in the same order as strings.
+//
+// If 'trace' is given, steps of every chunk are kept in memory until all chunks of the batch are matched, and then they are written in the order of strings.
+template <typename Matcher, typename Table>
+struct BatchWorkers
+{
+  // Matcher of a thread, with its own trace writer that isn't opened.
+  struct Worker
+  {
+    Matcher matcher;
+    TraceWriter trace;
+  };
+
+  const Table *table;
+  TraceWriter *trace = nullptr;
+
+  std::vector<std::thread> threads = { };
+  std::mutex mutex = { };
+  std::condition_variable batch_started = { };
+  std::condition_variable batch_finished = { };
+  uint64_t batch_index = 0;        // Incremented when a batch is started.
+  size_t busy_thread_count = 0;    // Threads that didn't finish the current batch yet.
+  bool is_stopping = false;
+
+  // Current batch.
+  const std::vector<std::string_view> *strings = nullptr;
+  std::vector<uint8_t> *results = nullptr;
+  std::vector<std::string> chunk_traces = { };
+  std::atomic<size_t> next_chunk = { 0 };
+  size_t chunk_count = 0;
+
+  Worker make_worker() const
+  {
+    return {
+      .matcher = Matcher{
+        .table = table,
+      },
+      .trace = TraceWriter{
+        .table = trace ? trace->table : nullptr,
+        .is_binary = trace && trace->is_binary,
+      },
+    };
+  }
+
+  void match_chunks(Worker &worker)
+  {
+    if constexpr (std::is_same_v<Matcher, TableMatcher>)
+      worker.matcher.trace = trace ? &worker.trace : nullptr;
+
+    size_t chunk;
+    while ((chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunk_count)
+      {
+        auto first = chunk * BATCH_CHUNK_SIZE;
+        auto last = std::min(first + BATCH_CHUNK_SIZE, strings->size());
+
+        for (auto i = first; i < last; i++)
+          (*results)[i] = worker.matcher.match((*strings)[i].data(), (*strings)[i].size());
+
+        if (trace)
+          chunk_traces[chunk].swap(worker.trace.buffer);
+      }
+  }
+
+  void run()
+  {
+    auto worker = make_worker();
+    uint64_t last_batch_index = 0;
+
+    while (true)
+      {
+        {
+          auto lock = std::unique_lock{ mutex };
+          batch_started.wait(lock, [this, last_batch_index]() { return is_stopping || batch_index != last_batch_index; });
+          if (is_stopping)
+            return;
+
+          last_batch_index = batch_index;
+        }
+
+        match_chunks(worker);
+
+        auto lock = std::unique_lock{ mutex };
+        if (--busy_thread_count == 0)
+          batch_finished.notify_one();
+      }
+  }
+
+  // Calling thread matches too, so only 'thread_count - 1' threads are started.
+  void start(size_t thread_count)
+  {
+    for (size_t i = 1; i < thread_count; i++)
+      threads.emplace_back([this]() { run(); });
+  }
+
+  void stop()
+  {
+    {
+      auto lock = std::unique_lock{ mutex };
+      is_stopping = true;
+    }
+
+    batch_started.notify_all();
+    for (auto &thread: threads)
+      thread.join();
+    threads.clear();
+  }
+
+  void match(const std::vector<std::string_view> &batch, std::vector<uint8_t> &batch_results, Worker &worker)
+  {
+    batch_results.resize(batch.size());
+
+    {
+      auto lock = std::unique_lock{ mutex };
+      strings = &batch;
+      results = &batch_results;
+      chunk_count = (batch.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+      chunk_traces.assign(trace ? chunk_count : 0, { });
+      next_chunk.store(0, std::memory_order_relaxed);
+      busy_thread_count = threads.size();
+      batch_index++;
+    }
+
+    batch_started.notify_all();
+    match_chunks(worker);
+
+    {
+      auto lock = std::unique_lock{ mutex };
+      batch_finished.wait(lock, [this]() { return busy_thread_count == 0; });
+    }
+
+    for (auto &steps: chunk_traces)
+      trace->append_traces(steps);
+  }
+};
+
+FILE *
+open_input_file(const char *filepath)
+{
+  if (strcmp(filepath, "-") == 0)
+    return stdin;
+
+  auto file = fopen(filepath, "rb");
+  if (!file)
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  return file;
+}
+
+// Matches every string in the file, which are separated by 'delimiter', and writes one result per line to standard output. Input is read in blocks, so only the longest string has to fit in memory. All complete strings in a block are matched as one batch. Steps are written to 'trace' if it's given.
+template <typename Matcher, typename Table>
+void
+match_strings_from_file(const Table &table, const char *filepath, char delimiter, size_t thread_count, TraceWriter *trace = nullptr)
+{
+  auto file = open_input_file(filepath);
+  auto input = std::vector<char>(BATCH_BUFFER_SIZE);
+  auto strings = std::vector<std::string_view>{ };
+  auto results = std::vector<uint8_t>{ };
+  auto output = std::string{ };
+  auto workers = BatchWorkers<Matcher, Table>{
+    .table = &table,
+    .trace = trace,
+  };
+  auto worker = workers.make_worker();
+
+  workers.start(thread_count);
+
+  auto const write_results =
+    [&output, &results]() -> void
+    {
+      output.clear();
+      for (auto result: results)
+        output.append(result ? "accepted\n" : "rejected\n");
+      fwrite(output.data(), 1, output.size(), stdout);
+    };
+
+  // Bytes in '[0, size)' weren't matched yet, and bytes in '[0, scanned)' don't contain a delimiter.
+  size_t size = 0, scanned = 0;
+
+  do
+    {
+      if (size == input.size())
+        input.resize(2 * input.size());
+
+      auto count = fread(&input[size], 1, input.size() - size, file);
+      if (count == 0)
+        break;
+
+      size += count;
+
+      auto data = input.data();
+      size_t start = 0;
+
+      strings.clear();
+      while (auto delimiter_at = (char *)memchr(data + scanned, delimiter, size - scanned))
+        {
+          strings.push_back({ data + start, size_t(delimiter_at - (data + start)) });
+          start = size_t(delimiter_at - data) + 1;
+          scanned = start;
+        }
+
+      workers.match(strings, results, worker);
+      write_results();
+
+      memmove(data, data + start, size - start);
+      size -= start;
+      scanned = size;
+    }
+  while (true);
+
+  workers.stop();
+
+  if (ferror(file))
+    {
+      std::cerr << "error: failed to read '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  // Last string might not end with a delimiter.
+  if (size > 0)
+    {
+      strings.assign(1, { input.data(), size });
+      workers.match(strings, results, worker);
+      write_results();
+    }
+
+  fflush(stdout);
+
+  if (file != stdin)
+    fclose(file);
+}
+
+// Matches the whole file as one string. The file is read in blocks that are given to 'TableMatcher::feed', so streams of any size are matched in constant memory. Reading stops at the first byte that can't be matched. Steps are written to 'trace' if it's given.
+bool
+match_stream(const CompiledTable &table, const char *filepath, TraceWriter *trace)
+{
+  auto file = open_input_file(filepath);
+  auto input = std::vector<char>(BATCH_BUFFER_SIZE);
+  auto matcher = TableMatcher{
+    .table = &table,
+    .trace = trace,
+  };
+
+  matcher.reset();
+
+  size_t count;
+  while ((count = fread(input.data(), 1, input.size(), file)) > 0)
+    if (!matcher.feed(input.data(), count))
+      break;
+
+  if (ferror(file))
+    {
+      std::cerr << "error: failed to read '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  auto result = matcher.finish();
+
+  if (file != stdin)
+    fclose(file);
+
+  return result;
+}
@@ -0,0 +1,594 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+#include <bitset>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <chrono>
+#include <random>
+#include <limits>
+
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <cassert>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "tokenizer.cpp"
+#include "grammar.cpp"
+#include "matcher.cpp"
+#include "lookahead.cpp"
+#include "mapped-file.cpp"
+#include "shift-run.cpp"
+#include "compiled-table.cpp"
+#include "parse-tree.cpp"
+#include "semantics.cpp"
+#include "trace.cpp"
+#include "table-matcher.cpp"
+#include "glr.cpp"
+#include "cmd.cpp"
+
+enum BenchOptionType
+  {
+    Bench_Table_Mode,
+    Bench_Json_Filepath,
+    Bench_Input_Size,
+    Bench_Min_Time,
+  };
+
+struct BenchConfig
+{
+  TableType table_type = Table_LALR;
+  const char *json_filepath = nullptr;
+  size_t input_size = 1 << 20;
+  double min_time = 0.5;
+};
+
+bool
+apply_option(void *ctx_ptr, const Option *option, const char *argument)
+{
+  auto &ctx = *(BenchConfig *)ctx_ptr;
+
+  switch ((BenchOptionType)option->id)
+    {
+    case Bench_Table_Mode:
+      {
+        if (strcmp("lr0", argument) == 0)
+          ctx.table_type = Table_LR0;
+        else if (strcmp("slr", argument) == 0)
+          ctx.table_type = Table_SLR;
+        else if (strcmp("lalr", argument) == 0)
+          ctx.table_type = Table_LALR;
+        else
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid table type\n";
+            return true;
+          }
+      }
+
+      break;
+    case Bench_Json_Filepath:
+      ctx.json_filepath = argument;
+      break;
+    case Bench_Input_Size:
+      {
+        char *end = nullptr;
+        auto size = strtoul(argument, &end, 10);
+
+        if (*argument == '\0' || *end != '\0' || size == 0)
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid input size\n";
+            return true;
+          }
+
+        ctx.input_size = size;
+      }
+
+      break;
+    case Bench_Min_Time:
+      {
+        char *end = nullptr;
+        auto seconds = strtod(argument, &end);
+
+        if (*argument == '\0' || *end != '\0' || !(seconds > 0))
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid time\n";
+            return true;
+          }
+
+        ctx.min_time = seconds;
+      }
+
+      break;
+    }
+
+  return false;
+}
+
+struct BenchGrammar
+{
+  std::string name;
+  std::string text;
+};
+
+// Expression grammar with 'level_count' levels of left associative binary operators.
+BenchGrammar
+make_ladder_grammar(size_t level_count)
+{
+  constexpr char operators[] = "+-*/%^&~<>=!?@#$";
+  assert(level_count > 0 && level_count < sizeof(operators));
+
+  auto result = BenchGrammar{
+    .name = "ladder-" + std::to_string(level_count),
+    .text = { },
+  };
+
+  for (size_t i = 0; i < level_count; i++)
+    {
+      auto level = "E" + std::to_string(i);
+      auto next = "E" + std::to_string(i + 1);
+      result.text += level + ": " + level + ' ' + operators[i] + ' ' + next + " | " + next + ";\n";
+    }
+
+  result.text += "E" + std::to_string(level_count) + ": (E0) | a | b;\n";
+  return result;
+}
+
+// Chain of 'variable_count' variables with three rules each, where the second rule jumps to another part of the chain. Rules of a variable start with different terminals, so the grammar is LL(1) and has no conflicts.
+BenchGrammar
+make_synthetic_grammar(size_t variable_count)
+{
+  constexpr char shift_terminals[] = "abcdefghijkl";
+  constexpr char jump_terminals[] = "mnopqrstuvwx";
+  constexpr char last_terminals[] = "yz0123456789";
+  constexpr size_t terminal_count = sizeof(shift_terminals) - 1;
+
+  auto result = BenchGrammar{
+    .name = "synthetic-" + std::to_string(variable_count),
+    .text = "S: S , V0 | V0;\n",
+  };
+
+  for (size_t i = 0; i < variable_count; i++)
+    {
+      auto variable = "V" + std::to_string(i);
+      auto next = "V" + std::to_string((i + 1) % variable_count);
+      auto jump = "V" + std::to_string((i * 7 + 3) % variable_count);
+      auto a = shift_terminals[i % terminal_count];
+      auto b = jump_terminals[(i / terminal_count) % terminal_count];
+      auto c = jump_terminals[i % terminal_count];
+      auto d = last_terminals[(i / terminal_count) % terminal_count];
+      auto e = last_terminals[i % terminal_count];
+
+      result.text += variable + ": " + a + ' ' + next + ' ' + b + " | " + c + ' ' + jump + ' ' + d + " | " + e + ";\n";
+    }
+
+  return result;
+}
+
+// Generates random strings of the language of 'grammar' until they take 'total_size' bytes. Derivations are random up to 'max_depth' or until the string is 'max_length' long, after that every variable is expanded by a rule with the shortest derivation.
+std::vector<std::string>
+generate_strings(Grammar &grammar, size_t total_size, std::mt19937 &random)
+{
+  constexpr uint32_t max_depth = 48;
+  constexpr size_t max_length = 512;
+  constexpr uint32_t NOT_PRODUCTIVE = UINT32_MAX;
+
+  auto variable_count = grammar.variable_count();
+  // Height of a variable is the least depth of a derivation tree that makes a string from it.
+  auto const rule_height =
+    [](const std::vector<uint32_t> &heights, const Grammar::Rule &rule) -> uint32_t
+    {
+      uint32_t height = 0;
+
+      for (size_t i = 1; i + 1 < rule.size(); i++)
+        if (is_variable(rule[i]))
+          {
+            auto child = heights[rule[i] - START_SYMBOL];
+            if (child == NOT_PRODUCTIVE)
+              return NOT_PRODUCTIVE;
+
+            height = std::max(height, child);
+          }
+
+      return height + 1;
+    };
+
+  auto heights = std::vector<uint32_t>(variable_count, NOT_PRODUCTIVE);
+  auto changed = true;
+  while (changed)
+    {
+      changed = false;
+
+      for (RuleId rule = 0; rule < grammar.rule_count(); rule++)
+        {
+          auto &height = heights[grammar.rule_variable(rule) - START_SYMBOL];
+          auto new_height = rule_height(heights, grammar.grab_rule(rule));
+
+          if (new_height < height)
+            {
+              height = new_height;
+              changed = true;
+            }
+        }
+    }
+
+  if (heights[FIRST_SYMBOL - START_SYMBOL] == NOT_PRODUCTIVE)
+    {
+      std::cerr << "error: grammar doesn't generate any string\n";
+      exit(EXIT_FAILURE);
+    }
+
+  struct Pending
+  {
+    SymbolType symbol;
+    uint32_t depth;
+  };
+
+  auto result = std::vector<std::string>{ };
+  auto pending = std::vector<Pending>{ };
+  auto productive = std::vector<RuleId>{ };
+  size_t size = 0;
+
+  while (size < total_size)
+    {
+      auto string = std::string{ };
+      pending.push_back({ FIRST_SYMBOL, 0 });
+
+      while (!pending.empty())
+        {
+          auto [symbol, depth] = pending.back();
+          pending.pop_back();
+
+          if (!is_variable(symbol))
+            {
+              string.push_back((char)symbol);
+              continue;
+            }
+
+          auto first = grammar.first_rules[symbol - START_SYMBOL];
+          auto last = grammar.first_rules[symbol - START_SYMBOL + 1];
+          auto rule = first;
+
+          if (depth < max_depth && string.size() < max_length)
+            {
+              productive.clear();
+              for (auto candidate = first; candidate < last; candidate++)
+                if (rule_height(heights, grammar.grab_rule(candidate)) != NOT_PRODUCTIVE)
+                  productive.push_back(candidate);
+
+              rule = productive[random() % productive.size()];
+            }
+          else
+            {
+              for (auto candidate = first; candidate < last; candidate++)
+                if (rule_height(heights, grammar.grab_rule(candidate)) == heights[symbol - START_SYMBOL])
+                  {
+                    rule = candidate;
+                    break;
+                  }
+            }
+
+          auto symbols = grammar.grab_rule(rule);
+          for (size_t i = symbols.size() - 1; i-- > 1; )
+            pending.push_back({ symbols[i], depth + 1 });
+        }
+
+      size += string.size() + 1;
+      result.push_back(std::move(string));
+    }
+
+  return result;
+}
+
+// Runs 'function' until it took at least 'min_time' seconds in total and returns the shortest run.
+template <typename Function>
+double
+measure_best_time(double min_time, Function &&function)
+{
+  using Clock = std::chrono::steady_clock;
+
+  auto best = std::numeric_limits<double>::infinity();
+  auto total = 0.0;
+
+  do
+    {
+      auto start = Clock::now();
+      function();
+      auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+      best = std::min(best, elapsed);
+      total += elapsed;
+    }
+  while (total < min_time);
+
+  return best;
+}
+
+struct MatchResult
+{
+  const char *matcher;
+  double mb_per_second;
+  double strings_per_second;
+  size_t accepted;
+  bool includes_strlen;  // Matcher takes strings ending with '\0', so the time includes finding their length.
+};
+
+// Matches all strings with 'matcher' repeatedly for at least 'min_time' seconds. Strings are given with their sizes, except to 'PDA', which has no such overload.
+template <typename Matcher>
+MatchResult
+measure_matching(const char *name, Matcher &matcher, const std::vector<std::string> &strings, double min_time)
+{
+  using Clock = std::chrono::steady_clock;
+
+  size_t bytes = 0;
+  for (auto &string: strings)
+    bytes += string.size();
+
+  size_t accepted = 0, passes = 0;
+  auto start = Clock::now();
+  auto elapsed = 0.0;
+
+  do
+    {
+      accepted = 0;
+      for (auto &string: strings)
+        {
+          if constexpr (std::is_same_v<Matcher, PDA>)
+            accepted += matcher.match(string.c_str());
+          else
+            accepted += matcher.match(string.data(), string.size());
+        }
+
+      passes++;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+  while (elapsed < min_time);
+
+  return { .matcher = name,
+           .mb_per_second = double(bytes * passes) / elapsed / 1e6,
+           .strings_per_second = double(strings.size() * passes) / elapsed,
+           .accepted = accepted,
+           .includes_strlen = std::is_same_v<Matcher, PDA>, };
+}
+
+struct BenchResult
+{
+  std::string name;
+  size_t rule_count;
+  size_t state_count;
+  size_t compiled_state_count;
+  size_t table_bytes;
+  double parse_grammar_ms;
+  double compute_table_ms;
+  double compute_lookaheads_ms;
+  size_t string_count;
+  size_t input_bytes;
+  std::vector<MatchResult> matches;
+};
+
+BenchResult
+run_benchmark(const BenchGrammar &bench, const BenchConfig &config, std::mt19937 &random)
+{
+  auto min_time = config.min_time / 4;
+
+  auto grammar = Grammar{ };
+  auto parse_time = measure_best_time(min_time, [&bench, &grammar]() {
+    grammar = parse_context_free_grammar(bench.text.c_str(), false);
+  });
+
+  auto table = ParsingTable{ };
+  auto table_time = measure_best_time(min_time, [&grammar, &table]() {
+    table = compute_parsing_table(grammar);
+  });
+
+  auto lookaheads_time = 0.0;
+  if (config.table_type != Table_LR0)
+    lookaheads_time = measure_best_time(min_time, [&grammar, &table, &config]() {
+      table = compute_parsing_table(grammar);
+      compute_lookaheads(table, config.table_type);
+    }) - table_time;
+
+  auto compiled_table = compile_parsing_table(grammar, table);
+  auto glr_table = build_glr_table(grammar, table);
+  auto strings = generate_strings(grammar, config.input_size, random);
+
+  auto result = BenchResult{
+    .name = bench.name,
+    .rule_count = grammar.rule_count(),
+    .state_count = table.states.size(),
+    .compiled_state_count = compiled_table.state_count,
+    .table_bytes = compiled_table.packed().size(),
+    .parse_grammar_ms = parse_time * 1e3,
+    .compute_table_ms = table_time * 1e3,
+    .compute_lookaheads_ms = std::max(lookaheads_time, 0.0) * 1e3,
+    .string_count = strings.size(),
+    .input_bytes = 0,
+    .matches = { },
+  };
+
+  for (auto &string: strings)
+    result.input_bytes += string.size();
+
+  auto pda = PDA{
+    .grammar = &grammar,
+    .table = &table,
+  };
+  auto matcher = TableMatcher{
+    .table = &compiled_table,
+  };
+  auto glr_matcher = GLRMatcher{
+    .table = &glr_table,
+  };
+
+  result.matches.push_back(measure_matching("pda", pda, strings, config.min_time));
+  result.matches.push_back(measure_matching("table", matcher, strings, config.min_time));
+  result.matches.push_back(measure_matching("glr", glr_matcher, strings, config.min_time));
+
+  for (auto &match: result.matches)
+    if (match.accepted != strings.size())
+      {
+        std::cerr << "error: "
+                  << match.matcher
+                  << " rejected generated strings of '"
+                  << bench.name
+                  << "'\n";
+        exit(EXIT_FAILURE);
+      }
+
+  return result;
+}
+
+std::string
+format_number(double value)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.3f", value);
+  return buffer;
+}
+
+void
+write_results_json(const std::vector<BenchResult> &results, const BenchConfig &config, const char *filepath)
+{
+  constexpr const char *table_names[] = { "lr0", "slr", "lalr" };
+
+  auto result = std::string{ };
+  result.append("{\n  \"table_type\": \"");
+  result.append(table_names[config.table_type]);
+  result.append("\",\n  \"grammars\": [");
+
+  for (size_t i = 0; i < results.size(); i++)
+    {
+      auto &bench = results[i];
+
+      result.append(i == 0 ? "\n" : ",\n");
+      result.append("    { \"name\": \"" + bench.name + "\"");
+      result.append(", \"rules\": " + std::to_string(bench.rule_count));
+      result.append(", \"states\": " + std::to_string(bench.state_count));
+      result.append(", \"compiled_states\": " + std::to_string(bench.compiled_state_count));
+      result.append(", \"table_bytes\": " + std::to_string(bench.table_bytes));
+      result.append(", \"parse_grammar_ms\": " + format_number(bench.parse_grammar_ms));
+      result.append(", \"compute_table_ms\": " + format_number(bench.compute_table_ms));
+      result.append(", \"compute_lookaheads_ms\": " + format_number(bench.compute_lookaheads_ms));
+      result.append(", \"strings\": " + std::to_string(bench.string_count));
+      result.append(", \"input_bytes\": " + std::to_string(bench.input_bytes));
+      result.append(",\n      \"matchers\": {");
+
+      for (size_t j = 0; j < bench.matches.size(); j++)
+        {
+          auto &match = bench.matches[j];
+
+          result.append(j == 0 ? " " : ", ");
+          result.append("\"" + std::string{ match.matcher } + "\": { ");
+          result.append("\"mb_per_s\": " + format_number(match.mb_per_second));
+          result.append(", \"strings_per_s\": " + format_number(match.strings_per_second));
+          result.append(match.includes_strlen ? ", \"includes_strlen\": true" : ", \"includes_strlen\": false");
+          result.append(" }");
+        }
+
+      result.append(" } }");
+    }
+
+  result.append("\n  ]\n}\n");
+
+  if (strcmp(filepath, "-") == 0)
+    {
+      std::cout << result;
+      return;
+    }
+
+  auto file = std::ofstream{ filepath, std::ofstream::trunc };
+  if (!file.is_open())
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+  file.write(&result[0], result.size());
+  file.close();
+}
+
+void
+print_results(const std::vector<BenchResult> &results)
+{
+  for (auto &bench: results)
+    {
+      printf("%-16s rules %6zu  states %6zu  parse %9.3f ms  table %9.3f ms  lookaheads %9.3f ms\n",
+             bench.name.c_str(), bench.rule_count, bench.state_count,
+             bench.parse_grammar_ms, bench.compute_table_ms, bench.compute_lookaheads_ms);
+      printf("  compiled table: %zu states, %zu bytes\n", bench.compiled_state_count, bench.table_bytes);
+
+      for (auto &match: bench.matches)
+        printf("  %-6s %10.2f MB/s %14.0f strings/s%s\n", match.matcher, match.mb_per_second, match.strings_per_second,
+               match.includes_strlen ? "  (includes strlen)" : "");
+    }
+}
+
+constexpr Option options[] = {
+  { .short_name = 'm', .has_arg = true, .id = Bench_Table_Mode },
+  { .short_name = '\0', .long_name = "json", .has_arg = true, .id = Bench_Json_Filepath },
+  { .short_name = '\0', .long_name = "input-size", .has_arg = true, .id = Bench_Input_Size },
+  { .short_name = '\0', .long_name = "min-time", .has_arg = true, .id = Bench_Min_Time },
+};
+
+int
+main(int argc, char **argv)
+{
+  auto config = BenchConfig{ };
+  auto last_non_option_index = parse_options(&config, argc, argv, options, sizeof(options) / sizeof(*options), 1);
+
+  auto benches = std::vector<BenchGrammar>{ };
+
+  // Grammars given as arguments replace the default corpus.
+  for (auto i = last_non_option_index; i < argc; i++)
+    benches.push_back({
+        .name = "arg-" + std::to_string(i - last_non_option_index),
+        .text = argv[i],
+      });
+
+  if (benches.empty())
+    {
+      benches.push_back({ .name = "parens", .text = "S: (S)S | " });
+      benches.push_back({ .name = "arithmetic", .text = "E: E+T | T; T: T*F | F; F: (E) | a" });
+      benches.push_back(make_ladder_grammar(4));
+      benches.push_back(make_ladder_grammar(12));
+      benches.push_back(make_synthetic_grammar(100));
+      benches.push_back(make_synthetic_grammar(1000));
+    }
+
+  // Fixed seed, so every run matches the same strings.
+  auto random = std::mt19937{ 1 };
+  auto results = std::vector<BenchResult>{ };
+
+  for (auto &bench: benches)
+    results.push_back(run_benchmark(bench, config, random));
+
+  if (config.json_filepath)
+    write_results_json(results, config, config.json_filepath);
+  else
+    print_results(results);
+}
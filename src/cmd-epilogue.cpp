@@ -1,15 +1,45 @@
 enum OptionType
   {
     Grammar_Form,
+    Grammar_Filepath,
+    Table_Mode,
+    Use_GLR,
     Generate_Automaton,
     Generate_Automaton_Steps,
+    Input_Filepath,
+    Stream_Filepath,
+    Match_Filepath,
+    Null_Delimited_Input,
+    Thread_Count,
+    Save_Table,
+    Load_Table,
+    Table_Stats,
+    Emit_Cpp,
+    Parse_Tree,
+    Tree_Format,
+    Steps_Format,
   };
 
 struct Config
 {
   bool use_bnf = false;
+  const char *grammar_filepath = nullptr;
+  TableType table_type = Table_LR0;
+  bool use_glr = false;
   const char *automaton_filepath = nullptr;
   const char *automaton_steps_filepath = nullptr;
+  const char *input_filepath = nullptr;
+  const char *stream_filepath = nullptr;
+  const char *match_filepath = nullptr;
+  char input_delimiter = '\n';
+  size_t thread_count = 1;
+  const char *save_table_filepath = nullptr;
+  const char *load_table_filepath = nullptr;
+  bool print_table_stats = false;
+  const char *emit_cpp_filepath = nullptr;
+  const char *parse_tree_filepath = nullptr;
+  bool use_binary_tree = false;
+  bool use_binary_steps = false;
 };
 
 bool
@@ -34,12 +64,116 @@ apply_option(void *ctx_ptr, const Option *option, const char *argument)
           }
       }
 
+      break;
+    case Grammar_Filepath:
+      ctx.grammar_filepath = argument;
+      break;
+    case Table_Mode:
+      {
+        if (strcmp("lr0", argument) == 0)
+          ctx.table_type = Table_LR0;
+        else if (strcmp("slr", argument) == 0)
+          ctx.table_type = Table_SLR;
+        else if (strcmp("lalr", argument) == 0)
+          ctx.table_type = Table_LALR;
+        else
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid table type\n";
+            return true;
+          }
+      }
+
+      break;
+    case Use_GLR:
+      ctx.use_glr = true;
       break;
     case Generate_Automaton:
       ctx.automaton_filepath = argument;
       break;
     case Generate_Automaton_Steps:
       ctx.automaton_steps_filepath = argument;
+      break;
+    case Input_Filepath:
+      ctx.input_filepath = argument;
+      break;
+    case Stream_Filepath:
+      ctx.stream_filepath = argument;
+      break;
+    case Match_Filepath:
+      ctx.match_filepath = argument;
+      break;
+    case Null_Delimited_Input:
+      ctx.input_delimiter = '\0';
+      break;
+    case Thread_Count:
+      {
+        // 'strtoul' accepts a sign and wraps negative numbers around, so the first character must be a digit.
+        char *end = nullptr;
+        errno = 0;
+        auto count = strtoul(argument, &end, 10);
+
+        if (!isdigit((unsigned char)*argument) || *end != '\0' || errno == ERANGE)
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid number of threads\n";
+            return true;
+          }
+
+        // More threads than cores only add switching between them.
+        auto core_count = size_t(std::max(std::thread::hardware_concurrency(), 1u));
+        ctx.thread_count = count != 0 ? std::min(size_t(count), core_count) : core_count;
+      }
+
+      break;
+    case Save_Table:
+      ctx.save_table_filepath = argument;
+      break;
+    case Load_Table:
+      ctx.load_table_filepath = argument;
+      break;
+    case Table_Stats:
+      ctx.print_table_stats = true;
+      break;
+    case Emit_Cpp:
+      ctx.emit_cpp_filepath = argument;
+      break;
+    case Parse_Tree:
+      ctx.parse_tree_filepath = argument;
+      break;
+    case Tree_Format:
+      {
+        if (strcmp("json", argument) == 0)
+          ctx.use_binary_tree = false;
+        else if (strcmp("binary", argument) == 0)
+          ctx.use_binary_tree = true;
+        else
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid format of parse tree\n";
+            return true;
+          }
+      }
+
+      break;
+    case Steps_Format:
+      {
+        if (strcmp("json", argument) == 0)
+          ctx.use_binary_steps = false;
+        else if (strcmp("binary", argument) == 0)
+          ctx.use_binary_steps = true;
+        else
+          {
+            std::cerr << "error: '"
+                      << argument
+                      << "' is not a valid format of steps\n";
+            return true;
+          }
+      }
+
       break;
     }
 
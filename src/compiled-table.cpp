@@ -0,0 +1,965 @@
+// Action code stored in 'CompiledTable'. Zero is an error, positive values are shifts to state 'code - 1', negative values are reductions by rule '-code - 1'.
+using ActionCode = int32_t;
+
+constexpr ActionCode ACTION_ERROR = 0;
+constexpr ActionCode ACTION_ACCEPT = INT32_MIN;
+
+constexpr StateId NO_STATE = UINT32_MAX;
+
+// One column per byte, and one for the end of input. Byte '\0' gets its own column, so strings with embedded zeros are handled correctly.
+constexpr size_t END_OF_INPUT_COLUMN = size_t(1) << (sizeof(TerminalType) * CHAR_BIT);
+constexpr size_t TERMINAL_COLUMN_COUNT = END_OF_INPUT_COLUMN + 1;
+
+constexpr ActionCode
+encode_shift(StateId state)
+{
+  return ActionCode(state) + 1;
+}
+
+constexpr ActionCode
+encode_reduce(RuleId rule)
+{
+  return -ActionCode(rule) - 1;
+}
+
+constexpr StateId
+decode_shift(ActionCode code)
+{
+  return StateId(code - 1);
+}
+
+constexpr RuleId
+decode_reduce(ActionCode code)
+{
+  return RuleId(-(code + 1));
+}
+
+constexpr char TABLE_MAGIC[8] = { 'L', 'R', 'T', 'A', 'B', 'L', 'E', '\0' };
+constexpr uint32_t TABLE_VERSION = 4;
+constexpr uint32_t TABLE_BYTE_ORDER = 0x01020304;
+// Limits counts in the header, so that sizes of sections can't overflow.
+constexpr uint32_t TABLE_MAX_COUNT = uint32_t(1) << 28;
+
+// Packed table starts with this header. Sections follow it in the order of fields of 'TableLayout', each one is aligned to 8 bytes.
+struct TableHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t state_count;
+  uint32_t unmerged_state_count;
+  uint32_t column_count;
+  uint32_t variable_count;
+  uint32_t rule_count;
+  uint32_t action_entry_count;
+  uint32_t goto_entry_count;
+  uint32_t run_count;
+  uint64_t names_size;
+};
+
+// Offsets of sections from the start of packed table.
+struct TableLayout
+{
+  size_t column_classes;
+  size_t action_defaults;
+  size_t action_bases;
+  size_t action_checks;
+  size_t action_values;
+  size_t goto_defaults;
+  size_t goto_bases;
+  size_t goto_checks;
+  size_t goto_values;
+  size_t state_runs;
+  size_t runs;
+  size_t rule_lengths;
+  size_t rule_variables;
+  size_t name_offsets;
+  size_t names;
+  size_t size;
+};
+
+TableLayout
+compute_table_layout(const TableHeader &header)
+{
+  auto const align =
+    [](size_t offset) -> size_t
+    {
+      return (offset + 7) & ~size_t(7);
+    };
+
+  auto layout = TableLayout{ };
+  size_t offset = align(sizeof(TableHeader));
+
+  layout.column_classes = offset;
+  offset = align(offset + sizeof(uint16_t) * TERMINAL_COLUMN_COUNT);
+  layout.action_defaults = offset;
+  offset = align(offset + sizeof(ActionCode) * header.state_count);
+  layout.action_bases = offset;
+  offset = align(offset + sizeof(uint32_t) * header.state_count);
+  layout.action_checks = offset;
+  offset = align(offset + sizeof(uint32_t) * header.action_entry_count);
+  layout.action_values = offset;
+  offset = align(offset + sizeof(ActionCode) * header.action_entry_count);
+  layout.goto_defaults = offset;
+  offset = align(offset + sizeof(StateId) * header.variable_count);
+  layout.goto_bases = offset;
+  offset = align(offset + sizeof(uint32_t) * header.variable_count);
+  layout.goto_checks = offset;
+  offset = align(offset + sizeof(uint32_t) * header.goto_entry_count);
+  layout.goto_values = offset;
+  offset = align(offset + sizeof(StateId) * header.goto_entry_count);
+  layout.state_runs = offset;
+  offset = align(offset + sizeof(uint32_t) * header.state_count);
+  layout.runs = offset;
+  offset = align(offset + sizeof(ShiftRun) * header.run_count);
+  layout.rule_lengths = offset;
+  offset = align(offset + sizeof(uint32_t) * header.rule_count);
+  layout.rule_variables = offset;
+  offset = align(offset + sizeof(SymbolType) * header.rule_count);
+  layout.name_offsets = offset;
+  offset = align(offset + sizeof(uint64_t) * (header.variable_count + 1));
+  layout.names = offset;
+  offset = align(offset + header.names_size);
+  layout.size = offset;
+
+  return layout;
+}
+
+// Matrix compressed with row displacement. Entries of row 'r' that differ from 'defaults[r]' are stored at 'bases[r] + column' in 'values', and 'checks' tells which row owns the entry. Rows are placed so that their entries don't collide, sparse rows fill holes of other rows.
+template <typename T>
+struct PackedRows
+{
+  const T *defaults = nullptr;
+  const uint32_t *bases = nullptr;
+  const uint32_t *checks = nullptr;
+  const T *values = nullptr;
+
+  T get(uint32_t row, size_t column) const
+  {
+    auto index = bases[row] + column;
+    return checks[index] == row ? values[index] : defaults[row];
+  }
+};
+
+// Parsing table compressed into arrays, so that matching doesn't need to walk lists of actions. Action rows are indexed by state, goto rows by variable. Arrays point into packed table, which is either owned by 'image' or mapped from a file.
+//
+// Bytes that have the same action in every state share one column of actions, so rows have as many columns as there are classes of such bytes, usually a few more than the number of terminals of the grammar.
+//
+// Rows of actions default to the most common reduction of the state, so errors in such states are found after the reduction, but before the next shift.
+struct CompiledTable
+{
+  size_t state_count = 0;
+  size_t unmerged_state_count = 0;             // Number of states before equivalent states were merged.
+  size_t variable_count = 0;
+  size_t rule_count = 0;
+  size_t action_entry_count = 0;
+  size_t goto_entry_count = 0;
+  size_t column_count = 0;                     // Number of classes of bytes.
+  const uint16_t *column_classes = nullptr;    // Column of actions for every byte and end of input.
+  PackedRows<ActionCode> actions = { };        // 'state_count' rows of 'column_count' columns.
+  PackedRows<StateId> gotos = { };             // 'variable_count' rows of 'state_count' columns.
+  size_t run_count = 0;
+  const uint32_t *state_runs = nullptr;        // Index of the run of the state in 'runs', or 'NO_RUN'.
+  const ShiftRun *runs = nullptr;
+  const uint32_t *rule_lengths = nullptr;      // Number of symbols on the right side of the rule.
+  const SymbolType *rule_variables = nullptr;  // Variable being defined by the rule.
+  const uint64_t *name_offsets = nullptr;      // Name of variable 'i' is in '[name_offsets[i], name_offsets[i + 1])'.
+  const char *names = nullptr;
+
+  std::vector<char> image = { };
+  MappedFile mapping = { };
+
+  ActionCode action(StateId state, size_t column) const
+  {
+    return actions.get(state, column_classes[column]);
+  }
+
+  StateId go(StateId state, SymbolType variable) const
+  {
+    return gotos.get(uint32_t(variable - START_SYMBOL), state);
+  }
+
+  std::string_view variable_name(SymbolType variable) const
+  {
+    auto index = variable - START_SYMBOL;
+    return { names + name_offsets[index], size_t(name_offsets[index + 1] - name_offsets[index]) };
+  }
+
+  std::string_view packed() const
+  {
+    if (mapping.data)
+      return { mapping.data, mapping.size };
+    else
+      return { image.data(), image.size() };
+  }
+};
+
+// Entries of a row given as pairs of column and value.
+template <typename T>
+using SparseRow = std::vector<std::pair<uint32_t, T>>;
+
+// Arrays of the table that is still being built. Actions are dense until the table is packed. Most states have gotos on few variables, so gotos are sparse from the start, otherwise they would take 'state_count * variable_count' entries.
+struct TableBuilder
+{
+  size_t state_count = 0;
+  size_t unmerged_state_count = 0;
+  size_t variable_count = 0;
+  size_t column_count = TERMINAL_COLUMN_COUNT;
+  std::vector<uint16_t> column_classes = { };  // Empty until columns are merged into classes.
+  std::vector<ActionCode> actions = { };  // 'state_count' rows of 'column_count' columns.
+  std::vector<SparseRow<StateId>> gotos = { };  // Gotos of every state, sorted by index of the variable.
+  std::vector<uint32_t> state_runs = { };
+  std::vector<ShiftRun> runs = { };
+  std::vector<uint32_t> rule_lengths = { };
+  std::vector<SymbolType> rule_variables = { };
+  std::string names = { };                  // Names of variables, copied from 'Grammar::names'.
+  std::vector<uint32_t> name_offsets = { };
+};
+
+// Target of goto on variable with 'variable_index' in sorted 'gotos' of a state, or 'NO_STATE'.
+StateId
+find_goto(const SparseRow<StateId> &gotos, uint32_t variable_index)
+{
+  auto it = std::lower_bound(gotos.begin(), gotos.end(), variable_index,
+                             [](const std::pair<uint32_t, StateId> &entry, uint32_t index) -> bool
+                             {
+                               return entry.first < index;
+                             });
+
+  return it != gotos.end() && it->first == variable_index ? it->second : NO_STATE;
+}
+
+template <typename T>
+struct RowPacker
+{
+  std::vector<T> defaults = { };
+  std::vector<uint32_t> bases = { };
+  std::vector<uint32_t> checks = { };
+  std::vector<T> values = { };
+};
+
+constexpr uint32_t NO_ROW = UINT32_MAX;
+
+// Places entries of 'rows' that differ from defaults with first fit, starting from the rows with the most entries, which are the hardest to place.
+template <typename T>
+RowPacker<T>
+pack_rows(const std::vector<SparseRow<T>> &rows, size_t column_count, std::vector<T> defaults)
+{
+  auto row_count = rows.size();
+  auto result = RowPacker<T>{
+    .defaults = std::move(defaults),
+    .bases = std::vector<uint32_t>(row_count, 0),
+  };
+
+  auto order = std::vector<uint32_t>(row_count);
+  for (size_t row = 0; row < row_count; row++)
+    order[row] = uint32_t(row);
+
+  std::stable_sort(order.begin(), order.end(),
+                   [&rows](uint32_t a, uint32_t b) -> bool
+                   {
+                     return rows[a].size() > rows[b].size();
+                   });
+
+  // Slot 'i' is free if 'next_free[i] == i', otherwise a free slot can be found by following 'next_free'. Candidate bases are found by jumping over used slots, rows are often so sparse that the first candidate fits.
+  auto next_free = std::vector<uint32_t>{ };
+  size_t size = column_count;
+
+  auto const find_free =
+    [&next_free](size_t slot) -> size_t
+    {
+      while (slot < next_free.size() && next_free[slot] != slot)
+        {
+          auto next = next_free[slot];
+          if (next < next_free.size())
+            next_free[slot] = next_free[next];
+          slot = next;
+        }
+
+      return slot;
+    };
+
+  for (auto row: order)
+    {
+      auto &entries = rows[row];
+      if (entries.empty())
+        continue;
+
+      auto first_column = entries[0].first;
+      size_t base;
+
+      for (auto slot = find_free(first_column); ; slot = find_free(slot + 1))
+        {
+          base = slot - first_column;
+
+          auto fits = true;
+          for (auto [column, _]: entries)
+            if (find_free(base + column) != base + column)
+              {
+                fits = false;
+                break;
+              }
+
+          if (fits)
+            break;
+        }
+
+      while (next_free.size() < base + column_count)
+        next_free.push_back(uint32_t(next_free.size()));
+
+      for (auto [column, _]: entries)
+        next_free[base + column] = uint32_t(base + column + 1);
+
+      result.bases[row] = uint32_t(base);
+      size = std::max(size, base + column_count);
+    }
+
+  result.checks.resize(size, NO_ROW);
+  result.values.resize(size, T{ });
+
+  for (size_t row = 0; row < row_count; row++)
+    for (auto [column, value]: rows[row])
+      {
+        auto index = result.bases[row] + column;
+        result.checks[index] = uint32_t(row);
+        result.values[index] = value;
+      }
+
+  return result;
+}
+
+void
+attach_table_arrays(CompiledTable &table, const char *packed)
+{
+  auto &header = *(const TableHeader *)packed;
+  auto layout = compute_table_layout(header);
+
+  table.state_count = header.state_count;
+  table.unmerged_state_count = header.unmerged_state_count;
+  table.variable_count = header.variable_count;
+  table.rule_count = header.rule_count;
+  table.action_entry_count = header.action_entry_count;
+  table.goto_entry_count = header.goto_entry_count;
+  table.column_count = header.column_count;
+  table.column_classes = (const uint16_t *)(packed + layout.column_classes);
+  table.actions = {
+    .defaults = (const ActionCode *)(packed + layout.action_defaults),
+    .bases = (const uint32_t *)(packed + layout.action_bases),
+    .checks = (const uint32_t *)(packed + layout.action_checks),
+    .values = (const ActionCode *)(packed + layout.action_values),
+  };
+  table.gotos = {
+    .defaults = (const StateId *)(packed + layout.goto_defaults),
+    .bases = (const uint32_t *)(packed + layout.goto_bases),
+    .checks = (const uint32_t *)(packed + layout.goto_checks),
+    .values = (const StateId *)(packed + layout.goto_values),
+  };
+  table.run_count = header.run_count;
+  table.state_runs = (const uint32_t *)(packed + layout.state_runs);
+  table.runs = (const ShiftRun *)(packed + layout.runs);
+  table.rule_lengths = (const uint32_t *)(packed + layout.rule_lengths);
+  table.rule_variables = (const SymbolType *)(packed + layout.rule_variables);
+  table.name_offsets = (const uint64_t *)(packed + layout.name_offsets);
+  table.names = packed + layout.names;
+}
+
+// Returns the most common value among 'values' that satisfy 'is_candidate', or 'otherwise' if there are none.
+template <typename T, typename Predicate>
+T
+find_most_common(std::vector<T> &values, T otherwise, Predicate &&is_candidate)
+{
+  std::sort(values.begin(), values.end());
+
+  auto result = otherwise;
+  size_t best_count = 0;
+
+  for (size_t i = 0, j; i < values.size(); i = j)
+    {
+      for (j = i; j < values.size() && values[j] == values[i]; j++) { }
+
+      if (is_candidate(values[i]) && j - i > best_count)
+        {
+          result = values[i];
+          best_count = j - i;
+        }
+    }
+
+  return result;
+}
+
+CompiledTable
+pack_table(const TableBuilder &builder)
+{
+  // Errors of states with default reductions are left to the reduction.
+  auto action_rows = std::vector<SparseRow<ActionCode>>(builder.state_count);
+  auto action_defaults = std::vector<ActionCode>(builder.state_count);
+  auto codes = std::vector<ActionCode>{ };
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    {
+      auto row = &builder.actions[state * builder.column_count];
+      codes.assign(row, row + builder.column_count);
+
+      auto default_code = find_most_common(codes, ACTION_ERROR,
+                                           [](ActionCode code) -> bool
+                                           {
+                                             return code < 0 && code != ACTION_ACCEPT;
+                                           });
+      action_defaults[state] = default_code;
+
+      for (size_t column = 0; column < builder.column_count; column++)
+        if (row[column] != ACTION_ERROR && row[column] != default_code)
+          action_rows[state].push_back({ uint32_t(column), row[column] });
+    }
+
+  // Missing gotos are never looked up, so they can be anything.
+  auto goto_rows = std::vector<SparseRow<StateId>>(builder.variable_count);
+  auto goto_defaults = std::vector<StateId>(builder.variable_count);
+  auto targets = std::vector<StateId>{ };
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    for (auto [variable, target]: builder.gotos[state])
+      goto_rows[variable].push_back({ uint32_t(state), target });
+
+  for (size_t variable = 0; variable < builder.variable_count; variable++)
+    {
+      auto &row = goto_rows[variable];
+
+      targets.clear();
+      for (auto [_, target]: row)
+        targets.push_back(target);
+
+      auto default_target = find_most_common(targets, NO_STATE,
+                                             [](StateId) -> bool
+                                             {
+                                               return true;
+                                             });
+      goto_defaults[variable] = default_target;
+
+      row.erase(std::remove_if(row.begin(), row.end(),
+                               [default_target](const std::pair<uint32_t, StateId> &entry) -> bool
+                               {
+                                 return entry.second == default_target;
+                               }),
+                row.end());
+    }
+
+  auto actions = pack_rows(action_rows, builder.column_count, std::move(action_defaults));
+  auto gotos = pack_rows(goto_rows, builder.state_count, std::move(goto_defaults));
+
+  auto header = TableHeader{ };
+  memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+  header.version = TABLE_VERSION;
+  header.byte_order = TABLE_BYTE_ORDER;
+  header.state_count = uint32_t(builder.state_count);
+  header.unmerged_state_count = uint32_t(builder.unmerged_state_count);
+  header.column_count = uint32_t(builder.column_count);
+  header.variable_count = uint32_t(builder.variable_count);
+  header.rule_count = uint32_t(builder.rule_lengths.size());
+  header.action_entry_count = uint32_t(actions.values.size());
+  header.goto_entry_count = uint32_t(gotos.values.size());
+  header.run_count = uint32_t(builder.runs.size());
+  header.names_size = builder.names.size();
+
+  auto layout = compute_table_layout(header);
+  auto result = CompiledTable{ };
+  result.image.resize(layout.size);
+
+  auto packed = result.image.data();
+  memcpy(packed, &header, sizeof(header));
+  memcpy(packed + layout.column_classes, builder.column_classes.data(), sizeof(uint16_t) * builder.column_classes.size());
+  memcpy(packed + layout.action_defaults, actions.defaults.data(), sizeof(ActionCode) * actions.defaults.size());
+  memcpy(packed + layout.action_bases, actions.bases.data(), sizeof(uint32_t) * actions.bases.size());
+  memcpy(packed + layout.action_checks, actions.checks.data(), sizeof(uint32_t) * actions.checks.size());
+  memcpy(packed + layout.action_values, actions.values.data(), sizeof(ActionCode) * actions.values.size());
+  memcpy(packed + layout.goto_defaults, gotos.defaults.data(), sizeof(StateId) * gotos.defaults.size());
+  memcpy(packed + layout.goto_bases, gotos.bases.data(), sizeof(uint32_t) * gotos.bases.size());
+  memcpy(packed + layout.goto_checks, gotos.checks.data(), sizeof(uint32_t) * gotos.checks.size());
+  memcpy(packed + layout.goto_values, gotos.values.data(), sizeof(StateId) * gotos.values.size());
+  memcpy(packed + layout.state_runs, builder.state_runs.data(), sizeof(uint32_t) * builder.state_runs.size());
+  memcpy(packed + layout.runs, builder.runs.data(), sizeof(ShiftRun) * builder.runs.size());
+  memcpy(packed + layout.rule_lengths, builder.rule_lengths.data(), sizeof(uint32_t) * builder.rule_lengths.size());
+  memcpy(packed + layout.rule_variables, builder.rule_variables.data(), sizeof(SymbolType) * builder.rule_variables.size());
+
+  auto name_offsets = (uint64_t *)(packed + layout.name_offsets);
+  std::copy(builder.name_offsets.begin(), builder.name_offsets.end(), name_offsets);
+  memcpy(packed + layout.names, builder.names.data(), builder.names.size());
+
+  attach_table_arrays(result, packed);
+
+  return result;
+}
+
+// Skips states whose only action is a reduction by a rule with one symbol, like 'T -> F'. Such state is entered by a shift or goto from state 't' and is immediately popped, exposing 't' again, so the transition can go directly to the goto of 't' on the variable of the rule. Chains of such rules collapse into one transition.
+//
+// Skipped state may reject some terminals, for example when its reduction has lookaheads. Transition is redirected only if the new target rejects all of them too, so errors are still detected before the next shift.
+void
+add_reduce_shortcuts(TableBuilder &builder)
+{
+  constexpr RuleId NO_RULE = UINT32_MAX;
+
+  auto unit_rules = std::vector<RuleId>(builder.state_count, NO_RULE);
+  auto error_columns = std::vector<std::bitset<TERMINAL_COLUMN_COUNT>>(builder.state_count);
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    {
+      auto row = &builder.actions[state * TERMINAL_COLUMN_COUNT];
+      auto code = ACTION_ERROR;
+
+      for (size_t column = 0; column < TERMINAL_COLUMN_COUNT; column++)
+        {
+          if (row[column] == ACTION_ERROR)
+            error_columns[state].set(column);
+          else if (code == ACTION_ERROR)
+            code = row[column];
+          else if (row[column] != code)
+            code = ACTION_ACCEPT;
+        }
+
+      if (code != ACTION_ERROR && code != ACTION_ACCEPT && code < 0 && builder.rule_lengths[decode_reduce(code)] == 1)
+        unit_rules[state] = decode_reduce(code);
+    }
+
+  auto const find_target =
+    [&builder, &unit_rules, &error_columns](StateId from, StateId to) -> StateId
+    {
+      auto errors = std::bitset<TERMINAL_COLUMN_COUNT>{ };
+
+      // Grammars with cycles of unit rules have conflicts, but the number of steps is bounded anyway.
+      for (size_t i = 0; i < builder.state_count && unit_rules[to] != NO_RULE; i++)
+        {
+          auto variable = builder.rule_variables[unit_rules[to]];
+          auto next = find_goto(builder.gotos[from], uint32_t(variable - START_SYMBOL));
+          assert(next != NO_STATE);
+
+          auto next_errors = errors | error_columns[to];
+          if ((next_errors & ~error_columns[next]).any())
+            break;
+
+          errors = next_errors;
+          to = next;
+        }
+
+      return to;
+    };
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    {
+      auto row = &builder.actions[state * TERMINAL_COLUMN_COUNT];
+      for (size_t column = 0; column < TERMINAL_COLUMN_COUNT; column++)
+        if (row[column] > 0)
+          row[column] = encode_shift(find_target(StateId(state), decode_shift(row[column])));
+
+      for (auto &[_, target]: builder.gotos[state])
+        target = find_target(StateId(state), target);
+    }
+}
+
+// Removes states that can't be reached (like the ones skipped by 'add_reduce_shortcuts') and merges states that behave the same way: they have equal actions and gotos, and their shifts and gotos lead to states that behave the same way. Classes of such states are found by refining partition of states until it's stable, and every class becomes one state.
+void
+merge_equivalent_states(TableBuilder &builder)
+{
+  auto state_count = builder.state_count;
+  auto &goto_rows = builder.gotos;
+
+  // Rows are sparse, so states are compared by their entries.
+  auto action_rows = std::vector<SparseRow<ActionCode>>(state_count);
+
+  for (size_t state = 0; state < state_count; state++)
+    for (size_t column = 0; column < TERMINAL_COLUMN_COUNT; column++)
+      if (auto code = builder.actions[state * TERMINAL_COLUMN_COUNT + column]; code != ACTION_ERROR)
+        action_rows[state].push_back({ uint32_t(column), code });
+
+  auto is_reachable = std::vector<bool>(state_count, false);
+  auto queue = std::vector<StateId>{ 0 };
+  is_reachable[0] = true;
+
+  auto const reach =
+    [&is_reachable, &queue](StateId state) -> void
+    {
+      if (!is_reachable[state])
+        {
+          is_reachable[state] = true;
+          queue.push_back(state);
+        }
+    };
+
+  while (!queue.empty())
+    {
+      auto state = queue.back();
+      queue.pop_back();
+
+      for (auto [_, code]: action_rows[state])
+        if (code > 0)
+          reach(decode_shift(code));
+
+      for (auto [_, target]: goto_rows[state])
+        reach(target);
+    }
+
+  // Signature of a state is its class and its entries with targets replaced by their classes. States of a class are split when their signatures differ. Classes are numbered in order of their first state, so state 0 stays in class 0.
+  auto classes = std::vector<uint32_t>(state_count, 0);
+  auto next_classes = std::vector<uint32_t>(state_count, NO_ROW);
+  auto signatures = std::map<std::vector<uint32_t>, uint32_t>{ };
+  auto signature = std::vector<uint32_t>{ };
+  size_t class_count = 1;
+  auto changed = true;
+
+  while (changed)
+    {
+      signatures.clear();
+
+      for (size_t state = 0; state < state_count; state++)
+        {
+          if (!is_reachable[state])
+            continue;
+
+          signature.clear();
+          signature.push_back(classes[state]);
+
+          for (auto [column, code]: action_rows[state])
+            {
+              signature.push_back(column);
+              signature.push_back(uint32_t(code > 0 ? encode_shift(classes[decode_shift(code)]) : code));
+            }
+
+          signature.push_back(NO_ROW);
+
+          for (auto [variable, target]: goto_rows[state])
+            {
+              signature.push_back(variable);
+              signature.push_back(classes[target]);
+            }
+
+          next_classes[state] = signatures.emplace(signature, uint32_t(signatures.size())).first->second;
+        }
+
+      classes.swap(next_classes);
+      changed = signatures.size() != class_count;
+      class_count = signatures.size();
+    }
+
+  auto actions = std::vector<ActionCode>(class_count * TERMINAL_COLUMN_COUNT, ACTION_ERROR);
+  auto gotos = std::vector<SparseRow<StateId>>(class_count);
+  auto is_copied = std::vector<bool>(class_count, false);
+
+  for (size_t state = 0; state < state_count; state++)
+    {
+      if (!is_reachable[state] || is_copied[classes[state]])
+        continue;
+
+      auto merged = classes[state];
+      is_copied[merged] = true;
+
+      for (auto [column, code]: action_rows[state])
+        actions[merged * TERMINAL_COLUMN_COUNT + column] = code > 0 ? encode_shift(classes[decode_shift(code)]) : code;
+
+      for (auto [variable, target]: goto_rows[state])
+        gotos[merged].push_back({ variable, classes[target] });
+    }
+
+  builder.state_count = class_count;
+  builder.actions = std::move(actions);
+  builder.gotos = std::move(gotos);
+}
+
+// Replaces columns of actions (bytes and end of input) with classes of columns that are equal in every state. Classes are numbered in order of their first column.
+void
+merge_equal_columns(TableBuilder &builder)
+{
+  assert(builder.column_count == TERMINAL_COLUMN_COUNT);
+
+  auto classes = std::map<std::vector<ActionCode>, uint16_t>{ };
+  auto column = std::vector<ActionCode>(builder.state_count);
+  auto first_columns = std::vector<size_t>{ };
+
+  builder.column_classes.resize(TERMINAL_COLUMN_COUNT);
+
+  for (size_t i = 0; i < TERMINAL_COLUMN_COUNT; i++)
+    {
+      for (size_t state = 0; state < builder.state_count; state++)
+        column[state] = builder.actions[state * TERMINAL_COLUMN_COUNT + i];
+
+      auto [it, is_new] = classes.emplace(column, uint16_t(classes.size()));
+      if (is_new)
+        first_columns.push_back(i);
+
+      builder.column_classes[i] = it->second;
+    }
+
+  auto column_count = first_columns.size();
+  auto actions = std::vector<ActionCode>(builder.state_count * column_count);
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    for (size_t i = 0; i < column_count; i++)
+      actions[state * column_count + i] = builder.actions[state * TERMINAL_COLUMN_COUNT + first_columns[i]];
+
+  builder.column_count = column_count;
+  builder.actions = std::move(actions);
+}
+
+// Finds states that shift some bytes back to themselves.
+void
+find_shift_runs(TableBuilder &builder)
+{
+  builder.state_runs.assign(builder.state_count, NO_RUN);
+  builder.runs.clear();
+
+  auto bytes = std::bitset<256>{ };
+
+  for (size_t state = 0; state < builder.state_count; state++)
+    {
+      bytes.reset();
+
+      for (size_t byte = 0; byte < bytes.size(); byte++)
+        {
+          auto column = builder.column_classes[byte];
+          if (builder.actions[state * builder.column_count + column] == encode_shift(StateId(state)))
+            bytes.set(byte);
+        }
+
+      if (bytes.any())
+        {
+          builder.state_runs[state] = uint32_t(builder.runs.size());
+          builder.runs.push_back(make_shift_run(bytes));
+        }
+    }
+}
+
+// Reductions by unit rules are skipped unless 'keep_unit_reductions' is set, which is needed to have their nodes in parse trees.
+CompiledTable
+compile_parsing_table(Grammar &grammar, ParsingTable &table, bool keep_unit_reductions = false)
+{
+  auto result = TableBuilder{
+    .state_count = table.states.size(),
+    .unmerged_state_count = table.states.size(),
+    .variable_count = grammar.variable_count(),
+  };
+  result.actions.resize(result.state_count * TERMINAL_COLUMN_COUNT, ACTION_ERROR);
+  result.gotos.resize(result.state_count);
+  result.names = grammar.names;
+  result.name_offsets = grammar.name_offsets;
+
+  for (RuleId rule = 0; rule < grammar.rule_count(); rule++)
+    {
+      result.rule_lengths.push_back(grammar.rule_length(rule));
+      result.rule_variables.push_back(grammar.rule_variable(rule));
+    }
+
+  auto has_conflicts = false;
+
+  for (auto &state: table.states)
+    {
+      auto row = &result.actions[state.id * TERMINAL_COLUMN_COUNT];
+      auto has_shift_reduce_conflict = false;
+      auto has_reduce_reduce_conflict = false;
+
+      for (auto &action: state.actions)
+        {
+          if (action.type != Action::Shift)
+            continue;
+
+          auto symbol = action.as.shift.label;
+          auto destination = action.as.shift.item->id;
+
+          if (is_variable(symbol))
+            result.gotos[state.id].push_back({ uint32_t(symbol - START_SYMBOL), destination });
+          else if (symbol == '\0')
+            row[END_OF_INPUT_COLUMN] = ACTION_ACCEPT;
+          else
+            row[(unsigned char)symbol] = encode_shift(destination);
+        }
+
+      auto const reduce_on =
+        [row, &has_shift_reduce_conflict, &has_reduce_reduce_conflict](size_t column, ActionCode code) -> void
+        {
+          if (row[column] == ACTION_ERROR)
+            row[column] = code;
+          else if (row[column] > 0 || row[column] == ACTION_ACCEPT)
+            has_shift_reduce_conflict = true;
+          else if (row[column] != code)
+            has_reduce_reduce_conflict = true;
+        };
+
+      for (auto &action: state.actions)
+        {
+          if (action.type != Action::Reduce)
+            continue;
+
+          auto code = encode_reduce(action.as.reduce.rule);
+          auto lookaheads = action.as.reduce.lookaheads;
+
+          // LR(0) reductions don't depend on the next terminal, so they fill every column.
+          if (!lookaheads)
+            {
+              for (size_t column = 0; column < TERMINAL_COLUMN_COUNT; column++)
+                reduce_on(column, code);
+            }
+          else
+            {
+              for (size_t terminal = 0; terminal < lookaheads->size(); terminal++)
+                if (lookaheads->test(terminal))
+                  reduce_on(terminal == 0 ? END_OF_INPUT_COLUMN : terminal, code);
+            }
+        }
+
+      if (has_shift_reduce_conflict || has_reduce_reduce_conflict)
+        {
+          has_conflicts = true;
+          std::cerr << "error: state "
+                    << state.id
+                    << " has "
+                    << (has_shift_reduce_conflict ? "shift/reduce" : "reduce/reduce")
+                    << " conflict\n";
+        }
+    }
+
+  if (has_conflicts)
+    exit(EXIT_FAILURE);
+
+  for (auto &gotos: result.gotos)
+    std::sort(gotos.begin(), gotos.end());
+
+  if (!keep_unit_reductions)
+    add_reduce_shortcuts(result);
+  merge_equivalent_states(result);
+  merge_equal_columns(result);
+  find_shift_runs(result);
+
+  return pack_table(result);
+}
+
+void
+save_compiled_table(const CompiledTable &table, const char *filepath)
+{
+  auto packed = table.packed();
+
+  auto file = std::ofstream{ filepath, std::ofstream::binary | std::ofstream::trunc };
+  if (!file.is_open())
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+  file.write(packed.data(), packed.size());
+  file.close();
+}
+
+// Checks that every index stored in the arrays of a loaded table is in range, so that matching never reads outside of them. Also checks that variables of reduced rules have gotos, because a missing goto is only looked up when the table is inconsistent.
+//
+// Lengths of rules can't be checked without running the automaton, 'TableMatcher' rejects the string instead when a reduction would pop the whole stack.
+bool
+has_valid_table_arrays(const CompiledTable &table, uint64_t names_size)
+{
+  auto const is_valid_action =
+    [&table](ActionCode code) -> bool
+    {
+      if (code == ACTION_ERROR || code == ACTION_ACCEPT)
+        return true;
+      else if (code > 0)
+        return decode_shift(code) < table.state_count;
+      else
+        {
+          auto rule = decode_reduce(code);
+          if (rule >= table.rule_count)
+            return false;
+
+          auto variable = table.rule_variables[rule];
+          return variable >= START_SYMBOL
+            && size_t(variable - START_SYMBOL) < table.variable_count
+            && table.gotos.defaults[variable - START_SYMBOL] != NO_STATE;
+        }
+    };
+
+  for (size_t column = 0; column < TERMINAL_COLUMN_COUNT; column++)
+    if (table.column_classes[column] >= table.column_count)
+      return false;
+
+  for (size_t i = 0; i < table.action_entry_count; i++)
+    if (!is_valid_action(table.actions.values[i])
+        || (table.actions.checks[i] != NO_ROW && table.actions.checks[i] >= table.state_count))
+      return false;
+
+  // End of input is never shifted, the matcher would take it for acceptance.
+  for (size_t state = 0; state < table.state_count; state++)
+    if (!is_valid_action(table.actions.defaults[state])
+        || table.actions.bases[state] + table.column_count > table.action_entry_count
+        || (table.state_runs[state] != NO_RUN && table.state_runs[state] >= table.run_count)
+        || table.action(StateId(state), END_OF_INPUT_COLUMN) > 0)
+      return false;
+
+  for (size_t variable = 0; variable < table.variable_count; variable++)
+    if ((table.gotos.defaults[variable] != NO_STATE && table.gotos.defaults[variable] >= table.state_count)
+        || table.gotos.bases[variable] + table.state_count > table.goto_entry_count)
+      return false;
+
+  for (size_t i = 0; i < table.goto_entry_count; i++)
+    if (table.gotos.values[i] >= table.state_count
+        || (table.gotos.checks[i] != NO_ROW && table.gotos.checks[i] >= table.variable_count))
+      return false;
+
+  for (size_t run = 0; run < table.run_count; run++)
+    if (table.runs[run].byte_count > RUN_MAX_LISTED_BYTES)
+      return false;
+
+  if (table.name_offsets[0] != 0 || table.name_offsets[table.variable_count] != names_size)
+    return false;
+
+  for (size_t variable = 0; variable < table.variable_count; variable++)
+    if (table.name_offsets[variable] > table.name_offsets[variable + 1])
+      return false;
+
+  return true;
+}
+
+// Maps table written by 'save_compiled_table'. The header and indices stored in the arrays are validated, so a corrupted table is reported instead of crashing the matcher later.
+CompiledTable
+load_compiled_table(const char *filepath)
+{
+  auto mapping = map_file(filepath);
+  auto const fail =
+    [filepath](const char *reason) -> void
+    {
+      std::cerr << "error: '"
+                << filepath
+                << "' "
+                << reason
+                << '\n';
+      exit(EXIT_FAILURE);
+    };
+
+  if (mapping.size < sizeof(TableHeader))
+    fail("is not a parsing table");
+
+  auto &header = *(const TableHeader *)mapping.data;
+
+  if (memcmp(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0)
+    fail("is not a parsing table");
+  if (header.version != TABLE_VERSION)
+    fail("has unsupported version of parsing table");
+  if (header.byte_order != TABLE_BYTE_ORDER)
+    fail("has parsing table with different byte order");
+  if (header.column_count == 0
+      || header.column_count > TERMINAL_COLUMN_COUNT
+      || header.state_count == 0
+      || header.state_count >= TABLE_MAX_COUNT
+      || header.variable_count >= TABLE_MAX_COUNT
+      || header.unmerged_state_count >= TABLE_MAX_COUNT
+      || header.rule_count >= TABLE_MAX_COUNT
+      || header.action_entry_count >= TABLE_MAX_COUNT
+      || header.goto_entry_count >= TABLE_MAX_COUNT
+      || header.run_count > header.state_count
+      || header.names_size >= TABLE_MAX_COUNT
+      || compute_table_layout(header).size > mapping.size)
+    fail("has corrupted parsing table");
+
+  auto result = CompiledTable{ };
+  result.mapping = std::move(mapping);
+  attach_table_arrays(result, result.mapping.data);
+
+  if (!has_valid_table_arrays(result, header.names_size))
+    fail("has corrupted parsing table");
+
+  return result;
+}
@@ -0,0 +1,208 @@
+// Writes 'values' as the body of a C++ array initializer, 16 values per line.
+template <typename T>
+void
+append_array_values(std::string &result, const T *values, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      result.append(i % 16 == 0 ? "\n    " : " ");
+      result.append(std::to_string(values[i]));
+      result.push_back(',');
+    }
+
+  result.append("\n  ");
+}
+
+template <typename T>
+void
+append_array(std::string &result, const char *type, const char *name, const T *values, size_t count)
+{
+  result.append("  constexpr ");
+  result.append(type);
+  result.push_back(' ');
+  result.append(name);
+  result.append("[");
+  result.append(std::to_string(std::max(count, size_t(1))));
+  result.append("] = {");
+  append_array_values(result, values, count);
+  result.append("};\n\n");
+}
+
+// Appends 'text' to a line comment. Control characters are written as '\xNN', so that names from BNF can't end the comment.
+void
+append_comment_text(std::string &result, std::string_view text)
+{
+  for (auto c: text)
+    {
+      auto byte = (unsigned char)c;
+
+      if (byte < 0x20 || byte == 0x7f)
+        {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\x%02x", byte);
+          result.append(escaped);
+        }
+      else
+        result.push_back(c);
+    }
+}
+
+// Code that does action 'code' in the generated matcher.
+std::string
+action_to_cpp(ActionCode code)
+{
+  if (code == ACTION_ERROR)
+    return "return false;";
+  else if (code == ACTION_ACCEPT)
+    return "return true;";
+  else if (code > 0)
+    return "state = " + std::to_string(decode_shift(code)) + "; goto shift;";
+  else
+    return "rule = " + std::to_string(decode_reduce(code)) + "; goto reduce;";
+}
+
+// Generates standalone C++ source with a matcher specialized for 'table'. Gotos, rules and byte classes are kept as 'constexpr' arrays, and actions become a switch over states with a switch over classes of bytes in every state, so the compiler sees every transition.
+void
+generate_cpp_matcher(const CompiledTable &table, const char *filepath)
+{
+  auto result = std::string{ };
+
+  result.append("// Generated by LR grammar matcher. Variables of the grammar:\n");
+  for (size_t i = 0; i < table.variable_count; i++)
+    {
+      result.append("//     ");
+      append_comment_text(result, table.variable_name(SymbolType(i) + START_SYMBOL));
+      result.push_back('\n');
+    }
+
+  result.append("\n"
+                "#include <cstddef>\n"
+                "#include <cstdint>\n"
+                "#include <vector>\n"
+                "\n"
+                "namespace lr_grammar\n"
+                "{\n");
+
+  auto gotos = table.gotos;
+
+  append_array(result, "uint16_t", "column_classes", table.column_classes, TERMINAL_COLUMN_COUNT);
+  append_array(result, "uint32_t", "rule_lengths", table.rule_lengths, table.rule_count);
+  append_array(result, "uint32_t", "rule_variables", table.rule_variables, table.rule_count);
+  append_array(result, "uint32_t", "goto_defaults", gotos.defaults, table.variable_count);
+  append_array(result, "uint32_t", "goto_bases", gotos.bases, table.variable_count);
+  append_array(result, "uint32_t", "goto_checks", gotos.checks, table.goto_entry_count);
+  append_array(result, "uint32_t", "goto_values", gotos.values, table.goto_entry_count);
+
+  result.append("  // Stack is kept between calls to avoid reallocations.\n"
+                "  struct Matcher\n"
+                "  {\n"
+                "    std::vector<uint32_t> stack;\n"
+                "\n"
+                "    bool match(const char *string, size_t size)\n"
+                "    {\n"
+                "      uint32_t state = 0, rule = 0;\n"
+                "      size_t consumed = 0;\n"
+                "\n"
+                "      stack.clear();\n"
+                "      stack.push_back(0);\n"
+                "\n"
+                "      while (true)\n"
+                "        {\n"
+                "          auto column = column_classes[consumed < size ? (unsigned char)string[consumed] : ");
+  result.append(std::to_string(END_OF_INPUT_COLUMN));
+  result.append("];\n"
+                "\n"
+                "          switch (state)\n"
+                "            {\n");
+
+  auto codes = std::vector<std::pair<ActionCode, uint32_t>>{ };
+
+  for (size_t state = 0; state < table.state_count; state++)
+    {
+      auto default_code = table.actions.defaults[state];
+
+      // Columns with the same action share one case.
+      codes.clear();
+      for (size_t column = 0; column < table.column_count; column++)
+        {
+          auto code = table.actions.get(uint32_t(state), column);
+          if (code != default_code)
+            codes.push_back({ code, uint32_t(column) });
+        }
+
+      std::sort(codes.begin(), codes.end());
+
+      result.append("            case ");
+      result.append(std::to_string(state));
+      result.append(":\n");
+
+      if (codes.empty())
+        {
+          result.append("              ");
+          result.append(action_to_cpp(default_code));
+          result.push_back('\n');
+          continue;
+        }
+
+      result.append("              switch (column)\n"
+                    "                {\n");
+
+      for (size_t i = 0; i < codes.size(); i++)
+        {
+          result.append("                case ");
+          result.append(std::to_string(codes[i].second));
+          result.append(":");
+
+          if (i + 1 < codes.size() && codes[i + 1].first == codes[i].first)
+            {
+              result.push_back('\n');
+              continue;
+            }
+
+          result.append(" ");
+          result.append(action_to_cpp(codes[i].first));
+          result.push_back('\n');
+        }
+
+      result.append("                default: ");
+      result.append(action_to_cpp(default_code));
+      result.append("\n"
+                    "                }\n");
+    }
+
+  result.append("            default:\n"
+                "              return false;\n"
+                "            }\n"
+                "\n"
+                "        shift:\n"
+                "          stack.push_back(state);\n"
+                "          consumed++;\n"
+                "          continue;\n"
+                "\n"
+                "        reduce:\n"
+                "          {\n"
+                "            stack.resize(stack.size() - rule_lengths[rule]);\n"
+                "\n"
+                "            auto variable = rule_variables[rule] - ");
+  result.append(std::to_string(START_SYMBOL));
+  result.append(";\n"
+                "            auto index = goto_bases[variable] + stack.back();\n"
+                "            state = goto_checks[index] == variable ? goto_values[index] : goto_defaults[variable];\n"
+                "            stack.push_back(state);\n"
+                "          }\n"
+                "        }\n"
+                "    }\n"
+                "  };\n"
+                "}\n");
+
+  auto file = std::ofstream{ filepath, std::ofstream::trunc };
+  if (!file.is_open())
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+  file.write(&result[0], result.size());
+  file.close();
+}
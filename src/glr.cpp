@@ -0,0 +1,406 @@
+// Reduction by 'rule' of the last 'length' symbols. It's shorter than the rule for right-nulled reductions.
+struct GLRReduction
+{
+  RuleId rule;
+  uint32_t length;
+  const TerminalSet *lookaheads;
+};
+
+// Table for GLR matching built from 'ParsingTable'. Unlike 'CompiledTable', it keeps every action of conflicting states.
+//
+// Reductions are right-nulled, as in RNGLR by Scott and Johnstone: item 'A -> x . y' where 'y' is nullable reduces 'A' by popping only 'x', with lookaheads of the reduction of 'A -> x y'. Rest of the rule is never reduced from empty strings, so paths of the stack never need to go through edges added by reductions of empty rules at the same position.
+struct GLRTable
+{
+  size_t state_count = 0;
+  size_t variable_count = 0;
+  std::vector<StateId> shifts = { };        // 'state_count' rows of 'TERMINAL_COLUMN_COUNT' columns.
+  std::vector<StateId> gotos = { };         // 'state_count' rows of 'variable_count' columns.
+  std::vector<uint8_t> accepts = { };       // State shifts end of input.
+  std::vector<uint32_t> reduction_offsets = { };  // Reductions of state 's' are '[reduction_offsets[s], reduction_offsets[s + 1])'.
+  std::vector<GLRReduction> reductions = { };
+  std::vector<uint32_t> rule_lengths = { };
+  std::vector<SymbolType> rule_variables = { };
+};
+
+GLRTable
+build_glr_table(Grammar &grammar, ParsingTable &table)
+{
+  auto result = GLRTable{
+    .state_count = table.states.size(),
+    .variable_count = grammar.variable_count(),
+  };
+  result.shifts.resize(result.state_count * TERMINAL_COLUMN_COUNT, NO_STATE);
+  result.gotos.resize(result.state_count * result.variable_count, NO_STATE);
+  result.accepts.resize(result.state_count, false);
+  result.reduction_offsets.push_back(0);
+
+  for (RuleId rule = 0; rule < grammar.rule_count(); rule++)
+    {
+      result.rule_lengths.push_back(grammar.rule_length(rule));
+      result.rule_variables.push_back(grammar.rule_variable(rule));
+    }
+
+  auto sets = compute_first_sets(grammar);
+
+  // Lookaheads of the reduction of 'rule' in the state reached from 'state' by 'symbols'.
+  auto const find_lookaheads =
+    [](State *state, const SymbolType *symbols, RuleId rule) -> const TerminalSet *
+    {
+      for (; *symbols != END_SYMBOL; symbols++)
+        state = find_action(Action::Shift, state->actions, *symbols)->as.shift.item;
+
+      for (auto &action: state->actions)
+        if (action.type == Action::Reduce && action.as.reduce.rule == rule)
+          return action.as.reduce.lookaheads;
+
+      assert(false);
+      return nullptr;
+    };
+
+  for (auto &state: table.states)
+    {
+      for (auto &action: state.actions)
+        switch (action.type)
+          {
+          case Action::Shift:
+            {
+              auto symbol = action.as.shift.label;
+              auto destination = action.as.shift.item->id;
+
+              if (is_variable(symbol))
+                result.gotos[state.id * result.variable_count + (symbol - START_SYMBOL)] = destination;
+              else if (symbol == '\0')
+                result.accepts[state.id] = true;
+              else
+                result.shifts[state.id * TERMINAL_COLUMN_COUNT + (unsigned char)symbol] = destination;
+            }
+
+            break;
+          case Action::Reduce:
+            {
+              result.reductions.push_back({
+                  .rule = action.as.reduce.rule,
+                  .length = result.rule_lengths[action.as.reduce.rule],
+                  .lookaheads = action.as.reduce.lookaheads,
+                });
+            }
+
+            break;
+          }
+
+      for (auto id: table.grab_items(state.itemset))
+        {
+          auto item = table.items.items[id];
+          auto rule = grammar.grab_rule(item.rule);
+          auto rest = rule.begin() + item.dot_index;
+
+          if (*rest != END_SYMBOL && is_nullable_sequence(sets, rest))
+            result.reductions.push_back({
+                .rule = item.rule,
+                .length = item.dot_index - 1,
+                .lookaheads = find_lookaheads(&state, rest, item.rule),
+              });
+        }
+
+      result.reduction_offsets.push_back(uint32_t(result.reductions.size()));
+    }
+
+  return result;
+}
+
+// Set of edges of the stack, as pairs of nodes, with open addressing and linear probing. Slots of earlier matches are told apart by 'epoch', so the set isn't cleared between strings.
+struct GLREdgeSet
+{
+  struct Slot
+  {
+    uint64_t key;
+    uint32_t epoch;  // Slot is empty if it differs from 'GLREdgeSet::epoch'.
+  };
+
+  std::vector<Slot> slots = std::vector<Slot>(64);  // Size is a power of two, at most half of the slots are used.
+  size_t count = 0;
+  uint32_t epoch = 1;
+
+  static size_t hash(uint64_t key)
+  {
+    return size_t((key * 0x9e3779b97f4a7c15) >> 32);
+  }
+
+  void clear()
+  {
+    count = 0;
+    if (++epoch == 0)
+      {
+        slots.assign(slots.size(), { });
+        epoch = 1;
+      }
+  }
+
+  // Returns false if the edge was already in the set.
+  bool insert(uint32_t from, uint32_t to)
+  {
+    auto key = (uint64_t(from) << 32) | to;
+    auto mask = slots.size() - 1;
+
+    for (auto i = hash(key) & mask; ; i = (i + 1) & mask)
+      {
+        auto &slot = slots[i];
+
+        if (slot.epoch != epoch)
+          {
+            slot = {
+              .key = key,
+              .epoch = epoch,
+            };
+
+            if (++count > slots.size() / 2)
+              grow();
+
+            return true;
+          }
+
+        if (slot.key == key)
+          return false;
+      }
+  }
+
+  void grow()
+  {
+    auto old_slots = std::move(slots);
+    slots.assign(2 * old_slots.size(), { });
+
+    auto mask = slots.size() - 1;
+    for (auto slot: old_slots)
+      if (slot.epoch == epoch)
+        {
+          auto i = hash(slot.key) & mask;
+          while (slots[i].epoch == epoch)
+            i = (i + 1) & mask;
+
+          slots[i] = slot;
+        }
+  }
+};
+
+// GLR recognizer with graph-structured stack. Stacks that reach the same state at the same position share one node, so the stack is a graph whose edges point to the previous node.
+//
+// When a reduction adds an edge to an existing node, only paths through the new edge are reduced, and edges are found in 'edge_set' instead of walking lists of edges. Right-nulled reductions of 'GLRTable' make this enough even with empty rules. Where the grammar is deterministic, every step adds a constant number of nodes and edges, and matching takes linear time.
+struct GLRMatcher
+{
+  constexpr static uint32_t NO_NODE = UINT32_MAX;
+  constexpr static uint32_t NO_EDGE = UINT32_MAX;
+
+  struct Node
+  {
+    StateId state;
+    uint32_t first_edge;
+    uint32_t first_target;  // Target of the edge that the node was created with, which isn't in 'edge_set'.
+    size_t position;
+  };
+
+  struct Edge
+  {
+    uint32_t node;
+    uint32_t next;
+  };
+
+  // Reduce by 'rule' every path of 'length' edges that starts at 'node'. If 'first_edge' is given, only paths that start with it are reduced.
+  struct Task
+  {
+    uint32_t node;
+    RuleId rule;
+    uint32_t length;
+    uint32_t first_edge;
+  };
+
+  const GLRTable *table;
+
+  std::vector<Node> nodes = { };
+  std::vector<Edge> edges = { };
+  GLREdgeSet edge_set = { };  // Edges added by reductions to existing nodes.
+  std::vector<uint32_t> level = { };
+  std::vector<uint32_t> next_level = { };
+  std::vector<uint32_t> node_by_state = { };
+  std::vector<Task> tasks = { };
+  std::vector<std::pair<uint32_t, uint32_t>> paths = { };
+  std::vector<uint32_t> path_ends = { };
+
+  static bool is_lookahead(const TerminalSet *lookaheads, size_t column)
+  {
+    if (!lookaheads)
+      return true;
+    else if (column == END_OF_INPUT_COLUMN)
+      return lookaheads->test(0);
+    else
+      return column != 0 && lookaheads->test(column);
+  }
+
+  // Returns node with 'state' at 'position', or creates it and adds it to 'nodes_at_position'.
+  uint32_t find_or_push_node(StateId state, size_t position, std::vector<uint32_t> &nodes_at_position, bool &was_pushed)
+  {
+    auto index = node_by_state[state];
+    was_pushed = index == NO_NODE || nodes[index].position != position;
+
+    if (was_pushed)
+      {
+        index = uint32_t(nodes.size());
+        nodes.push_back({
+            .state = state,
+            .first_edge = NO_EDGE,
+            .first_target = NO_NODE,
+            .position = position,
+          });
+        node_by_state[state] = index;
+        nodes_at_position.push_back(index);
+      }
+
+    return index;
+  }
+
+  uint32_t push_edge(uint32_t from, uint32_t to)
+  {
+    auto index = uint32_t(edges.size());
+    edges.push_back({
+        .node = to,
+        .next = nodes[from].first_edge,
+      });
+    nodes[from].first_edge = index;
+
+    if (nodes[from].first_target == NO_NODE)
+      nodes[from].first_target = to;
+
+    return index;
+  }
+
+  void push_tasks(uint32_t node, size_t column, uint32_t first_edge)
+  {
+    auto state = nodes[node].state;
+
+    for (auto i = table->reduction_offsets[state]; i < table->reduction_offsets[state + 1]; i++)
+      {
+        auto &reduction = table->reductions[i];
+
+        // Path that starts with a given edge has at least one symbol.
+        if (first_edge != NO_EDGE && reduction.length == 0)
+          continue;
+
+        if (is_lookahead(reduction.lookaheads, column))
+          tasks.push_back({
+              .node = node,
+              .rule = reduction.rule,
+              .length = reduction.length,
+              .first_edge = first_edge,
+            });
+      }
+  }
+
+  // Collects last nodes of paths of the task.
+  void find_path_ends(const Task &task)
+  {
+    path_ends.clear();
+    paths.clear();
+
+    if (task.first_edge != NO_EDGE)
+      paths.push_back({ edges[task.first_edge].node, task.length - 1 });
+    else
+      paths.push_back({ task.node, task.length });
+
+    while (!paths.empty())
+      {
+        auto [node, remaining] = paths.back();
+        paths.pop_back();
+
+        if (remaining == 0)
+          {
+            path_ends.push_back(node);
+            continue;
+          }
+
+        for (auto edge = nodes[node].first_edge; edge != NO_EDGE; edge = edges[edge].next)
+          paths.push_back({ edges[edge].node, remaining - 1 });
+      }
+  }
+
+  // Most nodes get only the edge they are created with, so it's compared directly and only later edges are kept in 'edge_set'. Edges added by shifts can't be added again by reductions, because targets of shifts and gotos are different states.
+  void reduce(size_t position, size_t column)
+  {
+    tasks.clear();
+    for (auto node: level)
+      push_tasks(node, column, NO_EDGE);
+
+    while (!tasks.empty())
+      {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        auto variable = table->rule_variables[task.rule];
+        find_path_ends(task);
+
+        for (auto end: path_ends)
+          {
+            auto state = table->gotos[nodes[end].state * table->variable_count + (variable - START_SYMBOL)];
+            assert(state != NO_STATE);
+
+            auto was_pushed = false;
+            auto node = find_or_push_node(state, position, level, was_pushed);
+
+            if (!was_pushed && (nodes[node].first_target == end || !edge_set.insert(node, end)))
+              continue;
+
+            auto edge = push_edge(node, end);
+            push_tasks(node, column, was_pushed ? NO_EDGE : edge);
+          }
+      }
+  }
+
+  bool match(const char *string, size_t size)
+  {
+    assert(table);
+
+    nodes.clear();
+    edges.clear();
+    edge_set.clear();
+    node_by_state.assign(table->state_count, NO_NODE);
+
+    auto was_pushed = false;
+    level.clear();
+    find_or_push_node(0, 0, level, was_pushed);
+
+    for (size_t position = 0; ; position++)
+      {
+        auto column = position < size ? (unsigned char)string[position] : END_OF_INPUT_COLUMN;
+
+        reduce(position, column);
+
+        if (column == END_OF_INPUT_COLUMN)
+          {
+            for (auto node: level)
+              if (table->accepts[nodes[node].state])
+                return true;
+
+            return false;
+          }
+
+        next_level.clear();
+        for (auto node: level)
+          {
+            auto state = table->shifts[nodes[node].state * TERMINAL_COLUMN_COUNT + column];
+            if (state == NO_STATE)
+              continue;
+
+            auto next = find_or_push_node(state, position + 1, next_level, was_pushed);
+            push_edge(next, node);
+          }
+
+        if (next_level.empty())
+          return false;
+
+        level.swap(next_level);
+      }
+  }
+
+  bool match(const char *string)
+  {
+    return match(string, strlen(string));
+  }
+};
@@ -7,47 +7,249 @@ constexpr SymbolType START_SYMBOL = 1 << (sizeof(TerminalType) * CHAR_BIT);
 constexpr SymbolType FIRST_SYMBOL = START_SYMBOL + 1;
 constexpr SymbolType END_SYMBOL = -1;
 
+using RuleId = uint32_t;
+
+// Rules are stored in compressed rows: symbols of all rules are one array and rule 'r' is '[rule_offsets[r], rule_offsets[r + 1])' in it. Rule starts with the variable it defines and ends with 'END_SYMBOL'. Rules of the same variable are consecutive and keep the order they were written in, so rules of variable 'v' are '[first_rules[v - START_SYMBOL], first_rules[v - START_SYMBOL + 1])'.
 struct Grammar
 {
-  // Rule stores the index of a symbol that is being defined in the beginning of the vector. In that way all rules that define the same symbol are consecutive in set.
-  using Rule = std::vector<SymbolType>;
+  // Symbols of one rule in 'Grammar::symbols'.
+  struct Rule
+  {
+    const SymbolType *first, *last;
+
+    const SymbolType *begin() const
+    {
+      return first;
+    }
+
+    const SymbolType *end() const
+    {
+      return last;
+    }
 
-  std::set<Rule> rules;
-  std::vector<std::string> lookup;
+    size_t size() const
+    {
+      return size_t(last - first);
+    }
 
-  std::string &grab_variable_name(SymbolType index)
+    SymbolType front() const
+    {
+      return *first;
+    }
+
+    SymbolType operator[](size_t index) const
+    {
+      assert(index < size());
+      return first[index];
+    }
+  };
+
+  std::vector<SymbolType> symbols = { };
+  std::vector<uint32_t> rule_offsets = { 0 };
+  std::vector<RuleId> first_rules = { 0 };
+  // Names of all variables with their brackets, name of variable 'v' is '[name_offsets[v - START_SYMBOL], name_offsets[v - START_SYMBOL + 1])'.
+  std::string names = { };
+  std::vector<uint32_t> name_offsets = { 0 };
+
+  size_t variable_count() const
+  {
+    return name_offsets.size() - 1;
+  }
+
+  std::string_view grab_variable_name(SymbolType index) const
   {
     assert(index >= START_SYMBOL);
-    return lookup[index - START_SYMBOL];
+    auto first = name_offsets[index - START_SYMBOL];
+    return { names.data() + first, name_offsets[index - START_SYMBOL + 1] - first };
+  }
+
+  // Appends name of the next variable.
+  SymbolType push_variable_name(std::string_view name)
+  {
+    auto symbol = SymbolType(variable_count()) + START_SYMBOL;
+
+    names.push_back('<');
+    names.append(name);
+    names.push_back('>');
+    name_offsets.push_back(uint32_t(names.size()));
+
+    return symbol;
+  }
+
+  size_t rule_count() const
+  {
+    return rule_offsets.size() - 1;
+  }
+
+  Rule grab_rule(RuleId rule) const
+  {
+    auto first = symbols.data();
+    return { first + rule_offsets[rule], first + rule_offsets[rule + 1] };
+  }
+
+  SymbolType rule_variable(RuleId rule) const
+  {
+    return symbols[rule_offsets[rule]];
+  }
+
+  // Number of symbols on the right side of the rule.
+  uint32_t rule_length(RuleId rule) const
+  {
+    return rule_offsets[rule + 1] - rule_offsets[rule] - 2;
+  }
+};
+
+// Stores rules written in 'symbols' with 'offsets' into 'grammar', grouped by their variables. Repeated rules are stored once.
+void
+store_rules(Grammar &grammar, const std::vector<SymbolType> &symbols, const std::vector<uint32_t> &offsets, size_t variable_count)
+{
+  auto rule_count = offsets.size() - 1;
+  auto const rule_bytes =
+    [&symbols, &offsets](size_t rule) -> std::string_view
+    {
+      auto first = (const char *)(symbols.data() + offsets[rule]);
+      return { first, sizeof(SymbolType) * (offsets[rule + 1] - offsets[rule]) };
+    };
+
+  // Rules are compared by their bytes, which is the same as comparing their symbols.
+  auto seen = std::unordered_set<std::string_view>{ };
+  auto is_repeated = std::vector<bool>(rule_count, false);
+  seen.reserve(rule_count);
+
+  grammar.first_rules.assign(variable_count + 1, 0);
+  for (size_t rule = 0; rule < rule_count; rule++)
+    {
+      is_repeated[rule] = !seen.insert(rule_bytes(rule)).second;
+      if (!is_repeated[rule])
+        grammar.first_rules[symbols[offsets[rule]] - START_SYMBOL + 1]++;
+    }
+
+  for (size_t i = 1; i < grammar.first_rules.size(); i++)
+    grammar.first_rules[i] += grammar.first_rules[i - 1];
+
+  auto next_ids = grammar.first_rules;
+  auto order = std::vector<uint32_t>(grammar.first_rules.back());
+  for (size_t rule = 0; rule < rule_count; rule++)
+    if (!is_repeated[rule])
+      order[next_ids[symbols[offsets[rule]] - START_SYMBOL]++] = uint32_t(rule);
+
+  grammar.symbols.clear();
+  grammar.symbols.reserve(symbols.size());
+  grammar.rule_offsets.assign(1, 0);
+  grammar.rule_offsets.reserve(order.size() + 1);
+
+  for (auto rule: order)
+    {
+      grammar.symbols.insert(grammar.symbols.end(), symbols.begin() + offsets[rule], symbols.begin() + offsets[rule + 1]);
+      grammar.rule_offsets.push_back(uint32_t(grammar.symbols.size()));
+    }
+}
+
+// Open addressing table from names of variables to their symbols, with linear probing. Names are kept only in 'Grammar::names', so a name seen for the first time is appended there and gets the next symbol.
+struct VariableInterner
+{
+  struct Slot
+  {
+    uint32_t hash;
+    SymbolType symbol;  // Zero if the slot is empty.
+  };
+
+  Grammar *grammar;
+  std::vector<Slot> slots = std::vector<Slot>(64);  // Size is a power of two, at most half of the slots are used.
+  size_t count = 0;
+
+  static uint32_t hash(std::string_view name)
+  {
+    // FNV-1a.
+    uint32_t result = 2166136261u;
+    for (auto ch: name)
+      result = (result ^ (unsigned char)ch) * 16777619u;
+
+    return result;
+  }
+
+  // Name of the variable without brackets.
+  std::string_view grab_name(SymbolType symbol) const
+  {
+    auto name = grammar->grab_variable_name(symbol);
+    return name.substr(1, name.size() - 2);
+  }
+
+  // Returns symbol of 'name' and whether it was added.
+  std::pair<SymbolType, bool> intern(std::string_view name)
+  {
+    auto name_hash = hash(name);
+    auto mask = slots.size() - 1;
+
+    for (auto i = name_hash & mask; ; i = (i + 1) & mask)
+      {
+        auto &slot = slots[i];
+
+        if (slot.symbol == 0)
+          {
+            slot = {
+              .hash = name_hash,
+              .symbol = grammar->push_variable_name(name),
+            };
+
+            auto symbol = slot.symbol;
+            if (++count > slots.size() / 2)
+              grow();
+
+            return { symbol, true };
+          }
+
+        if (slot.hash == name_hash && grab_name(slot.symbol) == name)
+          return { slot.symbol, false };
+      }
   }
 
-  std::set<Rule>::iterator find_first_rule(SymbolType symbol)
+  void grow()
   {
-    return rules.lower_bound({ symbol });
+    auto old_slots = std::move(slots);
+    slots.assign(2 * old_slots.size(), { });
+
+    auto mask = slots.size() - 1;
+    for (auto slot: old_slots)
+      if (slot.symbol != 0)
+        {
+          auto i = slot.hash & mask;
+          while (slots[i].symbol != 0)
+            i = (i + 1) & mask;
+
+          slots[i] = slot;
+        }
   }
 };
 
+// Source is parsed in place and doesn't need to end with '\0', so it can be a mapped file. Grammar doesn't refer to it after parsing.
 Grammar
-parse_context_free_grammar(const char *string, bool use_bnf)
+parse_context_free_grammar(std::string_view source, bool use_bnf)
 {
+  // Indexed by symbol of the variable minus 'START_SYMBOL', like its name.
   struct VariableInfo
   {
-    LineInfo line_info;
-    SymbolType index;
+    size_t offset;
     bool is_defined;
   };
 
-  using VariableTable = std::map<std::string_view, VariableInfo>;
-
   auto t = Tokenizer{
     .ctx = {
-      .source = string,
+      .source = source.data(),
+      .source_end = source.data() + source.size(),
     },
-    .buffer_token = use_bnf ? buffer_token_bnf : buffer_token_custom,
+    .use_bnf = use_bnf,
   };
   auto g = Grammar{ };
-  auto variables = VariableTable{ };
-  auto next_symbol_index = FIRST_SYMBOL;
+  g.push_variable_name("start");
+
+  auto interner = VariableInterner{
+    .grammar = &g,
+  };
+  auto variables = std::vector<VariableInfo>(1);
+  // Rules in the order they are written, stored into 'g' once all variables are known.
+  auto rule_symbols = std::vector<SymbolType>{ };
+  auto rule_offsets = std::vector<uint32_t>{ 0 };
   auto failed_to_parse = false;
 
   do
@@ -56,8 +258,7 @@ parse_context_free_grammar(const char *string, bool use_bnf)
         {
           failed_to_parse = true;
 
-          auto line_info = t.grab().line_info;
-          PRINT_ERROR0(line_info, "expected a variable to start production");
+          PRINT_ERROR0(t.locate(t.grab()), "expected a variable to start production");
 
           // Skip to next production.
           if (t.peek(1) != Token::Define)
@@ -75,17 +276,12 @@ parse_context_free_grammar(const char *string, bool use_bnf)
         auto token = t.grab();
         t.advance();
 
-        auto info = VariableInfo{
-          .line_info = token.line_info,
-          .index = next_symbol_index,
-          .is_defined = true,
-        };
-        auto [it, was_inserted] = variables.emplace(token.text, info);
-        auto &[key, value] = *it;
-        next_symbol_index += was_inserted;
-
-        variable_definition_index = value.index;
-        value.is_defined = true;
+        auto [symbol, was_inserted] = interner.intern(token.text);
+        if (was_inserted)
+          variables.push_back({ .offset = token.offset, .is_defined = false });
+
+        variable_definition_index = symbol;
+        variables[symbol - START_SYMBOL].is_defined = true;
       }
 
       if (!t.expect(Token::Define))
@@ -93,13 +289,12 @@ parse_context_free_grammar(const char *string, bool use_bnf)
           failed_to_parse = true;
 
           auto token = t.grab();
-          PRINT_ERROR(token.line_info, "expected ':' or '::=' before '%.*s'", (int)token.text.size(), token.text.data());
+          PRINT_ERROR(t.locate(token), "expected ':' or '::=' before '%.*s'", (int)token.text.size(), token.text.data());
         }
 
       do
         {
-          auto rule = Grammar::Rule{ };
-          rule.push_back(variable_definition_index);
+          rule_symbols.push_back(variable_definition_index);
 
           do
             {
@@ -109,16 +304,11 @@ parse_context_free_grammar(const char *string, bool use_bnf)
                 case Token::Variable:
                   {
                     auto token = t.grab();
-                    auto info = VariableInfo{
-                      .line_info = token.line_info,
-                      .index = next_symbol_index,
-                      .is_defined = false,
-                    };
-                    auto [it, was_inserted] = variables.emplace(token.text, info);
-                    auto &[key, value] = *it;
-                    next_symbol_index += was_inserted;
-
-                    rule.push_back(value.index);
+                    auto [symbol, was_inserted] = interner.intern(token.text);
+                    if (was_inserted)
+                      variables.push_back({ .offset = token.offset, .is_defined = false });
+
+                    rule_symbols.push_back(symbol);
                   }
 
                   break;
@@ -128,7 +318,7 @@ parse_context_free_grammar(const char *string, bool use_bnf)
                     for (size_t i = 0; i < text.size(); i++)
                       {
                         i += (text[i] == '\\');
-                        rule.push_back(text[i]);
+                        rule_symbols.push_back(text[i]);
                       }
                   }
 
@@ -137,8 +327,7 @@ parse_context_free_grammar(const char *string, bool use_bnf)
                   {
                     failed_to_parse = true;
 
-                    auto line_info = t.grab().line_info;
-                    PRINT_ERROR0(line_info, "expected variable or terminal");
+                    PRINT_ERROR0(t.locate(t.grab()), "expected variable or terminal");
                     t.skip_to_next_delimiter();
                   }
 
@@ -153,8 +342,8 @@ parse_context_free_grammar(const char *string, bool use_bnf)
           while (true);
         finish_parsing_sequence_of_terminals_and_variables:
 
-          rule.push_back(END_SYMBOL);
-          g.rules.insert(std::move(rule));
+          rule_symbols.push_back(END_SYMBOL);
+          rule_offsets.push_back(uint32_t(rule_symbols.size()));
         }
       while (t.expect(Token::Bar));
 
@@ -166,36 +355,29 @@ parse_context_free_grammar(const char *string, bool use_bnf)
   if (failed_to_parse)
     exit(EXIT_FAILURE);
 
-  g.lookup.resize(variables.size() + 1);
-  g.rules.insert({
+  rule_symbols.insert(rule_symbols.end(), {
       START_SYMBOL,
       FIRST_SYMBOL,
       '\0',
       END_SYMBOL,
     });
-  g.lookup[0] = "<start>";
+  rule_offsets.push_back(uint32_t(rule_symbols.size()));
 
-  for (auto &[name, variable]: variables)
-    {
-      if (!variable.is_defined)
-        {
-          failed_to_parse = true;
-          PRINT_ERROR(variable.line_info, "variable '%.*s' is not defined", (int)name.size(), name.data());
-        }
+  for (size_t i = 1; i < variables.size(); i++)
+    if (!variables[i].is_defined)
+      {
+        auto name = interner.grab_name(SymbolType(i) + START_SYMBOL);
 
-      auto &variable_name = g.grab_variable_name(variable.index);
-      auto new_name = std::string{ };
-      new_name.reserve(name.size() + 2);
-      new_name.push_back('<');
-      new_name.append(name);
-      new_name.push_back('>');
-      variable_name = std::move(new_name);
-    }
+        failed_to_parse = true;
+        PRINT_ERROR(locate(t.ctx, variables[i].offset), "variable '%.*s' is not defined", (int)name.size(), name.data());
+      }
 
   // Another exit if there are not defined symbols.
   if (failed_to_parse)
     exit(EXIT_FAILURE);
 
+  store_rules(g, rule_symbols, rule_offsets, g.variable_count());
+
   return g;
 }
 
@@ -0,0 +1,365 @@
+// Computes 'sets[x]' as the union of 'sets[y]' for every 'y' reachable from 'x' through 'edges' (including 'x' itself). This is 'Digraph' algorithm from DeRemer and Pennello: nodes of a strongly connected component end up with the same set, and every edge is traversed once.
+void
+propagate_sets(const std::vector<std::vector<uint32_t>> &edges, std::vector<TerminalSet> &sets)
+{
+  struct Frame
+  {
+    uint32_t node;
+    uint32_t depth;
+    size_t next_edge;
+  };
+
+  constexpr uint32_t DONE = UINT32_MAX;
+
+  auto depths = std::vector<uint32_t>(edges.size(), 0);
+  auto stack = std::vector<uint32_t>{ };
+  auto frames = std::vector<Frame>{ };
+
+  // Recursion is replaced with explicit frames, since chains of nodes can be as long as the grammar.
+  auto const visit =
+    [&depths, &stack, &frames](uint32_t node) -> void
+    {
+      stack.push_back(node);
+      auto depth = uint32_t(stack.size());
+      depths[node] = depth;
+      frames.push_back({
+          .node = node,
+          .depth = depth,
+          .next_edge = 0,
+        });
+    };
+
+  for (uint32_t root = 0; root < edges.size(); root++)
+    {
+      if (depths[root] != 0)
+        continue;
+
+      visit(root);
+
+      while (!frames.empty())
+        {
+          auto &frame = frames.back();
+          auto x = frame.node;
+
+          if (frame.next_edge < edges[x].size())
+            {
+              auto y = edges[x][frame.next_edge++];
+
+              if (depths[y] == 0)
+                visit(y);
+              else
+                {
+                  depths[x] = std::min(depths[x], depths[y]);
+                  sets[x] |= sets[y];
+                }
+
+              continue;
+            }
+
+          auto depth = frame.depth;
+          frames.pop_back();
+
+          if (depths[x] == depth)
+            {
+              uint32_t top;
+              do
+                {
+                  top = stack.back();
+                  stack.pop_back();
+                  depths[top] = DONE;
+                  sets[top] = sets[x];
+                }
+              while (top != x);
+            }
+
+          if (!frames.empty())
+            {
+              auto parent = frames.back().node;
+              depths[parent] = std::min(depths[parent], depths[x]);
+              sets[parent] |= sets[x];
+            }
+        }
+    }
+}
+
+struct GrammarSets
+{
+  std::vector<bool> nullable;
+  std::vector<TerminalSet> first;
+};
+
+// Adds FIRST of 'symbols' (which ends with 'END_SYMBOL') to 'set'. Returns true if all symbols are nullable.
+bool
+add_first_of_sequence(const GrammarSets &sets, const SymbolType *symbols, TerminalSet &set)
+{
+  for (; *symbols != END_SYMBOL; symbols++)
+    {
+      auto symbol = *symbols;
+
+      if (!is_variable(symbol))
+        {
+          set.set((unsigned char)symbol);
+          return false;
+        }
+
+      set |= sets.first[symbol - START_SYMBOL];
+      if (!sets.nullable[symbol - START_SYMBOL])
+        return false;
+    }
+
+  return true;
+}
+
+bool
+is_nullable_sequence(const GrammarSets &sets, const SymbolType *symbols)
+{
+  for (; *symbols != END_SYMBOL; symbols++)
+    if (!is_variable(*symbols) || !sets.nullable[*symbols - START_SYMBOL])
+      return false;
+
+  return true;
+}
+
+GrammarSets
+compute_first_sets(const Grammar &grammar)
+{
+  auto variable_count = grammar.variable_count();
+  auto result = GrammarSets{
+    .nullable = std::vector<bool>(variable_count, false),
+    .first = std::vector<TerminalSet>(variable_count),
+  };
+
+  auto changed = true;
+  while (changed)
+    {
+      changed = false;
+
+      for (RuleId id = 0; id < grammar.rule_count(); id++)
+        {
+          auto rule = grammar.grab_rule(id);
+          auto index = rule[0] - START_SYMBOL;
+          if (result.nullable[index])
+            continue;
+
+          auto is_nullable = true;
+          for (size_t i = 1; i + 1 < rule.size() && is_nullable; i++)
+            is_nullable = is_variable(rule[i]) && result.nullable[rule[i] - START_SYMBOL];
+
+          if (is_nullable)
+            {
+              result.nullable[index] = true;
+              changed = true;
+            }
+        }
+    }
+
+  // Variable 'v' is connected to 'w' if 'w' is at the start of a rule of 'v', possibly after nullable variables.
+  auto edges = std::vector<std::vector<uint32_t>>(variable_count);
+  for (RuleId id = 0; id < grammar.rule_count(); id++)
+    {
+      auto rule = grammar.grab_rule(id);
+      auto index = rule[0] - START_SYMBOL;
+
+      for (size_t i = 1; i + 1 < rule.size(); i++)
+        {
+          auto symbol = rule[i];
+
+          if (!is_variable(symbol))
+            {
+              result.first[index].set((unsigned char)symbol);
+              break;
+            }
+
+          edges[index].push_back(uint32_t(symbol - START_SYMBOL));
+          if (!result.nullable[symbol - START_SYMBOL])
+            break;
+        }
+    }
+
+  propagate_sets(edges, result.first);
+
+  return result;
+}
+
+void
+compute_slr_lookaheads(ParsingTable &table, const GrammarSets &sets)
+{
+  auto &grammar = *table.items.grammar;
+  auto variable_count = grammar.variable_count();
+  auto follow = std::vector<TerminalSet>(variable_count);
+
+  // FOLLOW of 'A' includes FOLLOW of 'B' if 'B -> x A y' and 'y' is nullable.
+  auto edges = std::vector<std::vector<uint32_t>>(variable_count);
+  for (RuleId id = 0; id < grammar.rule_count(); id++)
+    {
+      auto rule = grammar.grab_rule(id);
+      auto index = rule[0] - START_SYMBOL;
+
+      for (size_t i = 1; i + 1 < rule.size(); i++)
+        {
+          auto symbol = rule[i];
+          if (!is_variable(symbol))
+            continue;
+
+          if (add_first_of_sequence(sets, rule.begin() + i + 1, follow[symbol - START_SYMBOL]))
+            edges[symbol - START_SYMBOL].push_back(uint32_t(index));
+        }
+    }
+
+  propagate_sets(edges, follow);
+
+  auto lookaheads = std::vector<const TerminalSet *>(variable_count);
+  for (size_t i = 0; i < variable_count; i++)
+    lookaheads[i] = &table.lookaheads.emplace_back(follow[i]);
+
+  for (auto &state: table.states)
+    for (auto &action: state.actions)
+      if (action.type == Action::Reduce)
+        action.as.reduce.lookaheads = lookaheads[grammar.rule_variable(action.as.reduce.rule) - START_SYMBOL];
+}
+
+// LALR(1) lookaheads computed with relations from DeRemer and Pennello, "Efficient Computation of LALR(1) Look-Ahead Sets".
+void
+compute_lalr_lookaheads(ParsingTable &table, const GrammarSets &sets)
+{
+  auto &grammar = *table.items.grammar;
+
+  auto states = std::vector<State *>(table.states.size());
+  for (auto &state: table.states)
+    states[state.id] = &state;
+
+  // Transitions of every state sorted by symbol. For variables the target is replaced by the index of the transition in 'goto_targets'.
+  using Transition = std::pair<SymbolType, StateId>;
+
+  auto transitions = std::vector<std::vector<Transition>>(states.size());
+  auto goto_targets = std::vector<StateId>{ };
+
+  for (auto state: states)
+    {
+      auto &list = transitions[state->id];
+
+      for (auto &action: state->actions)
+        if (action.type == Action::Shift)
+          {
+            auto symbol = action.as.shift.label;
+            auto target = action.as.shift.item->id;
+
+            if (is_variable(symbol))
+              {
+                list.push_back({ symbol, StateId(goto_targets.size()) });
+                goto_targets.push_back(target);
+              }
+            else
+              list.push_back({ symbol, target });
+          }
+
+      std::sort(list.begin(), list.end());
+    }
+
+  auto const find_transition =
+    [&transitions](StateId state, SymbolType symbol) -> StateId
+    {
+      auto &list = transitions[state];
+      auto it = std::lower_bound(list.begin(), list.end(), Transition{ symbol, 0 });
+      assert(it != list.end() && it->first == symbol);
+      return it->second;
+    };
+
+  auto const go =
+    [&find_transition, &goto_targets](StateId state, SymbolType symbol) -> StateId
+    {
+      auto target = find_transition(state, symbol);
+      return is_variable(symbol) ? goto_targets[target] : target;
+    };
+
+  // Direct reads of transition '(p, A)' are terminals shifted from the target of the transition, and '(p, A)' reads '(r, C)' if 'C' is nullable.
+  auto follow = std::vector<TerminalSet>(goto_targets.size());
+  auto edges = std::vector<std::vector<uint32_t>>(goto_targets.size());
+
+  for (size_t i = 0; i < goto_targets.size(); i++)
+    for (auto [symbol, target]: transitions[goto_targets[i]])
+      {
+        if (!is_variable(symbol))
+          follow[i].set((unsigned char)symbol);
+        else if (sets.nullable[symbol - START_SYMBOL])
+          edges[i].push_back(target);
+      }
+
+  propagate_sets(edges, follow);
+
+  // '(p, A)' includes '(q, B)' if 'B -> x A y', 'y' is nullable and 'q' goes to 'p' on 'x'. State 'r' with reduction 'B -> x' looks back at '(q, B)' if 'q' goes to 'r' on 'x'.
+  struct Lookback
+  {
+    RuleId rule;
+    uint32_t transition;
+  };
+
+  auto lookbacks = std::vector<std::vector<Lookback>>(states.size());
+
+  for (auto &list: edges)
+    list.clear();
+
+  for (auto state: states)
+    for (auto [symbol, index]: transitions[state->id])
+      {
+        if (!is_variable(symbol))
+          continue;
+
+        auto variable_index = symbol - START_SYMBOL;
+
+        for (auto rule_id = grammar.first_rules[variable_index]; rule_id < grammar.first_rules[variable_index + 1]; rule_id++)
+          {
+            auto rule = grammar.grab_rule(rule_id);
+            auto at = state->id;
+
+            for (size_t i = 1; i + 1 < rule.size(); i++)
+              {
+                auto rule_symbol = rule[i];
+
+                if (is_variable(rule_symbol) && is_nullable_sequence(sets, rule.begin() + i + 1))
+                  edges[find_transition(at, rule_symbol)].push_back(index);
+
+                at = go(at, rule_symbol);
+              }
+
+            lookbacks[at].push_back({
+                .rule = rule_id,
+                .transition = index,
+              });
+          }
+      }
+
+  propagate_sets(edges, follow);
+
+  for (auto state: states)
+    for (auto &action: state->actions)
+      if (action.type == Action::Reduce)
+        {
+          auto &lookaheads = table.lookaheads.emplace_back();
+
+          for (auto &lookback: lookbacks[state->id])
+            if (lookback.rule == action.as.reduce.rule)
+              lookaheads |= follow[lookback.transition];
+
+          action.as.reduce.lookaheads = &lookaheads;
+        }
+}
+
+// Adds lookaheads to reduce actions of LR(0) table.
+void
+compute_lookaheads(ParsingTable &table, TableType type)
+{
+  auto sets = compute_first_sets(*table.items.grammar);
+
+  switch (type)
+    {
+    case Table_LR0:
+      break;
+    case Table_SLR:
+      compute_slr_lookaheads(table, sets);
+      break;
+    case Table_LALR:
+      compute_lalr_lookaheads(table, sets);
+      break;
+    }
+}
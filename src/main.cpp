@@ -1,31 +1,75 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <stack>
 #include <string>
 #include <list>
-#include <set>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <memory>
+#include <bitset>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
 
 #include <cstring>
+#include <cctype>
+#include <cerrno>
 #include <cstdint>
 #include <climits>
 #include <cassert>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "tokenizer.cpp"
 #include "grammar.cpp"
 #include "matcher.cpp"
+#include "lookahead.cpp"
+#include "mapped-file.cpp"
+#include "shift-run.cpp"
+#include "compiled-table.cpp"
+#include "parse-tree.cpp"
+#include "semantics.cpp"
+#include "trace.cpp"
+#include "table-matcher.cpp"
+#include "glr.cpp"
+#include "emit-cpp.cpp"
+#include "batch.cpp"
 #include "other-stuff.cpp"
 #include "cmd.cpp"
 #include "cmd-epilogue.cpp"
 
 constexpr Option options[] = {
   { .short_name = 'f', .has_arg = true, .id = Grammar_Form },
+  { .short_name = '\0', .long_name = "grammar-file", .has_arg = true, .id = Grammar_Filepath },
+  { .short_name = 'm', .has_arg = true, .id = Table_Mode },
+  { .short_name = '\0', .long_name = "glr", .has_arg = false, .id = Use_GLR },
   { .short_name = '\0', .long_name = "generate-automaton", .has_arg = true, .id = Generate_Automaton },
   { .short_name = '\0', .long_name = "generate-steps", .has_arg = true, .id = Generate_Automaton_Steps },
+  { .short_name = '\0', .long_name = "input", .has_arg = true, .id = Input_Filepath },
+  { .short_name = '\0', .long_name = "stream", .has_arg = true, .id = Stream_Filepath },
+  { .short_name = '\0', .long_name = "match-file", .has_arg = true, .id = Match_Filepath },
+  { .short_name = 'z', .long_name = "null-data", .has_arg = false, .id = Null_Delimited_Input },
+  { .short_name = 'j', .long_name = "jobs", .has_arg = true, .id = Thread_Count },
+  { .short_name = '\0', .long_name = "save-table", .has_arg = true, .id = Save_Table },
+  { .short_name = '\0', .long_name = "load-table", .has_arg = true, .id = Load_Table },
+  { .short_name = '\0', .long_name = "table-stats", .has_arg = false, .id = Table_Stats },
+  { .short_name = '\0', .long_name = "emit-cpp", .has_arg = true, .id = Emit_Cpp },
+  { .short_name = '\0', .long_name = "parse-tree", .has_arg = true, .id = Parse_Tree },
+  { .short_name = '\0', .long_name = "tree-format", .has_arg = true, .id = Tree_Format },
+  { .short_name = '\0', .long_name = "steps-format", .has_arg = true, .id = Steps_Format },
 };
 
 int
@@ -34,36 +78,161 @@ main(int argc, char **argv)
   auto config = Config{ };
   auto last_non_option_index = parse_options(&config, argc, argv, options, sizeof(options) / sizeof(*options), 1);
 
-  if (argc - last_non_option_index == 0)
+  auto grammar = Grammar{ };
+  auto table = ParsingTable{ };
+  auto compiled_table = CompiledTable{ };
+  auto glr_table = GLRTable{ };
+  auto first_string_index = last_non_option_index;
+
+  if (config.use_glr && (config.load_table_filepath || config.save_table_filepath || config.automaton_steps_filepath || config.stream_filepath || config.emit_cpp_filepath || config.parse_tree_filepath))
+    {
+      std::cerr << "error: '--glr' can't be used with '--load-table', '--save-table', '--generate-steps', '--stream', '--emit-cpp' or '--parse-tree'\n";
+      return EXIT_FAILURE;
+    }
+
+  if (config.parse_tree_filepath && (config.input_filepath || config.stream_filepath))
     {
-      std::cerr << "error: missing grammar\nusage: [OPTIONS] [GRAMMAR] [STRINGS_TO_MATCH]\n";
+      std::cerr << "error: '--parse-tree' can't be used with '--input' or '--stream'\n";
       return EXIT_FAILURE;
     }
 
-  auto grammar = parse_context_free_grammar(argv[last_non_option_index], config.use_bnf);
-  auto table = compute_parsing_table(grammar);
-  auto pda = PDA{
-    .grammar = &grammar,
-    .table = &table,
+  if (config.automaton_steps_filepath && config.parse_tree_filepath)
+    {
+      std::cerr << "error: '--generate-steps' can't be used with '--parse-tree'\n";
+      return EXIT_FAILURE;
+    }
+
+  if (config.load_table_filepath)
+    {
+      if (config.automaton_filepath || config.save_table_filepath || config.grammar_filepath)
+        {
+          std::cerr << "error: '--load-table' can't be used with options that need a grammar\n";
+          return EXIT_FAILURE;
+        }
+
+      compiled_table = load_compiled_table(config.load_table_filepath);
+    }
+  else
+    {
+      if (config.grammar_filepath)
+        {
+          // Grammar is parsed directly from the mapping, and all arguments are strings.
+          auto file = map_file(config.grammar_filepath, MADV_SEQUENTIAL);
+          grammar = parse_context_free_grammar({ file.data, file.size }, config.use_bnf);
+        }
+      else
+        {
+          if (argc - last_non_option_index == 0)
+            {
+              std::cerr << "error: missing grammar\nusage: [OPTIONS] [GRAMMAR] [STRINGS_TO_MATCH]\n";
+              return EXIT_FAILURE;
+            }
+
+          grammar = parse_context_free_grammar(argv[last_non_option_index], config.use_bnf);
+          first_string_index++;
+        }
+
+      table = compute_parsing_table(grammar);
+      if (config.table_type != Table_LR0)
+        compute_lookaheads(table, config.table_type);
+
+      if (config.automaton_filepath)
+        generate_automaton_json(table, config.automaton_filepath);
+
+      if (config.use_glr)
+        glr_table = build_glr_table(grammar, table);
+      else if (first_string_index < argc || config.input_filepath || config.stream_filepath || config.match_filepath || config.save_table_filepath || config.print_table_stats || config.emit_cpp_filepath || config.automaton_steps_filepath)
+        compiled_table = compile_parsing_table(grammar, table, config.parse_tree_filepath || config.automaton_steps_filepath);
+
+      if (config.save_table_filepath)
+        save_compiled_table(compiled_table, config.save_table_filepath);
+    }
+
+  if (config.print_table_stats && !config.use_glr)
+    print_table_stats(compiled_table);
+
+  if (config.emit_cpp_filepath)
+    generate_cpp_matcher(compiled_table, config.emit_cpp_filepath);
+
+  auto tree = ParseTree{ };
+  auto trace = TraceWriter{
+    .table = &compiled_table,
+    .is_binary = config.use_binary_steps,
+  };
+  auto matcher = TableMatcher{
+    .table = &compiled_table,
+    .tree = config.parse_tree_filepath ? &tree : nullptr,
+    .trace = config.automaton_steps_filepath ? &trace : nullptr,
+  };
+  auto glr_matcher = GLRMatcher{
+    .table = &glr_table,
   };
 
-  if (config.automaton_filepath)
-    generate_automaton_json(table, config.automaton_filepath);
+  // Trees of rejected strings aren't written.
+  auto const write_parse_tree =
+    [&config, &tree, &compiled_table](const char *filepath) -> void
+    {
+      if (tree.root == NO_NODE)
+        return;
+      else if (config.use_binary_tree)
+        save_parse_tree(tree, filepath);
+      else
+        generate_parse_tree_json(tree, compiled_table, filepath);
+    };
+
+  // Steps of strings, '--match-file', '--stream' and '--input' are written to one file, in this order.
+  if (config.automaton_steps_filepath)
+    trace.open(config.automaton_steps_filepath);
 
-  for (int i = last_non_option_index + 1, j = 0; i < argc; i++, j++)
+  for (int i = first_string_index, j = 0; i < argc; i++, j++)
     {
       auto string = argv[i];
-      auto result = pda.match(string);
+      auto result = config.use_glr ? glr_matcher.match(string) : matcher.match(string);
       std::cout << "'" << string << "': ";
       std::cout << (result ? "accepted" : "rejected") << '\n';
 
-      if (config.automaton_steps_filepath)
+      if (config.parse_tree_filepath)
         {
-          auto name = std::string{ config.automaton_steps_filepath } + std::to_string(j);
-          pda.generate_automaton_steps_json(string, name.c_str());
+          auto name = std::string{ config.parse_tree_filepath } + std::to_string(j);
+          write_parse_tree(name.c_str());
         }
     }
 
-  print_grammar(grammar);
-  print_pushdown_automaton(grammar, table);
+  if (config.match_filepath)
+    {
+      // Matched in place, the file is neither copied nor required to end with '\0'.
+      auto file = map_file(config.match_filepath, MADV_SEQUENTIAL);
+      auto result = config.use_glr ? glr_matcher.match(file.data, file.size) : matcher.match(file.data, file.size);
+      std::cout << (result ? "accepted" : "rejected") << '\n';
+
+      if (config.parse_tree_filepath)
+        write_parse_tree(config.parse_tree_filepath);
+    }
+
+  if (config.stream_filepath)
+    {
+      auto result = match_stream(compiled_table, config.stream_filepath, matcher.trace);
+      std::cout << (result ? "accepted" : "rejected") << '\n';
+    }
+
+  if (config.input_filepath)
+    {
+      std::cout.flush();
+      if (config.use_glr)
+        match_strings_from_file<GLRMatcher>(glr_table, config.input_filepath, config.input_delimiter, config.thread_count);
+      else
+        match_strings_from_file<TableMatcher>(compiled_table, config.input_filepath, config.input_delimiter, config.thread_count, matcher.trace);
+    }
+
+  if (config.automaton_steps_filepath)
+    trace.close();
+
+  if (config.match_filepath || config.stream_filepath || config.input_filepath)
+    return EXIT_SUCCESS;
+
+  if (!config.load_table_filepath)
+    {
+      print_grammar(grammar);
+      print_pushdown_automaton(grammar, table);
+    }
 }
@@ -0,0 +1,82 @@
+// Read-only mapping of a whole file. Unmaps the file when destroyed.
+struct MappedFile
+{
+  const char *data = nullptr;
+  size_t size = 0;
+
+  MappedFile() = default;
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other)
+    : data{ other.data }, size{ other.size }
+  {
+    other.data = nullptr;
+    other.size = 0;
+  }
+
+  MappedFile &operator=(MappedFile &&other)
+  {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+
+  ~MappedFile()
+  {
+    if (size > 0)
+      munmap((void *)data, size);
+  }
+};
+
+// 'advice' is given to 'madvise', like 'MADV_SEQUENTIAL' for files that are read once from start to end.
+MappedFile
+map_file(const char *filepath, int advice = MADV_NORMAL)
+{
+  auto fd = open(filepath, O_RDONLY);
+  if (fd < 0)
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+    {
+      std::cerr << "error: failed to read '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  auto result = MappedFile{ };
+
+  // 'mmap' doesn't accept empty mappings.
+  if (info.st_size > 0)
+    {
+      auto data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        {
+          std::cerr << "error: failed to map '"
+                    << filepath
+                    << "'\n";
+          exit(EXIT_FAILURE);
+        }
+
+      // Advice only affects performance, so failure isn't an error.
+      if (advice != MADV_NORMAL)
+        madvise(data, size_t(info.st_size), advice);
+
+      result.data = (const char *)data;
+      result.size = size_t(info.st_size);
+    }
+  else
+    result.data = "";
+
+  close(fd);
+
+  return result;
+}
@@ -1,34 +1,180 @@
+using ItemId = uint32_t;
+
+// Rule and position of the dot in it. 'dot_index' is an index into 'Grammar::Rule', so it starts from 1.
 struct Item
 {
-  Grammar::Rule *rule;
-  size_t dot_index;
+  RuleId rule;
+  uint32_t dot_index;
+};
 
-  SymbolType symbol_at_dot() const
-  {
-    return (*rule)[dot_index];
-  }
+// Items are interned: every pair of rule and dot position has its own id. Ids are ordered by symbol at dot, then by dot position and then by rule, so items of sorted item set are grouped by the symbol at dot.
+struct ItemTable
+{
+  const Grammar *grammar;                  // Rules are read from the grammar, which has to outlive the table.
+  std::vector<ItemId> first_items;         // Item with dot at the start of the rule, indexed by rule id.
+  std::vector<Item> items;
+  std::vector<SymbolType> symbols_at_dot;
+  std::vector<ItemId> shifted_items;       // Item with dot moved past the symbol at dot.
+  // Variables whose rules are added by closure of variable 'v' (including 'v' itself) are '[closure_offsets[v - START_SYMBOL], closure_offsets[v - START_SYMBOL + 1])' in 'closure_variables'.
+  std::vector<uint32_t> closure_offsets;
+  std::vector<SymbolType> closure_variables;
+};
 
-  Item shift_dot() const
-  {
-    auto index = this->dot_index;
-    index += (symbol_at_dot() != END_SYMBOL);
+// Precomputes closure of every variable, so that building a state only needs to merge closures of variables after the dot.
+void
+compute_variable_closures(ItemTable &items)
+{
+  auto &grammar = *items.grammar;
+  auto variable_count = grammar.variable_count();
+
+  // Variable 'v' is connected to 'w' if some rule of 'v' starts with 'w'.
+  auto first_variables = std::vector<std::vector<SymbolType>>(variable_count);
+  for (size_t index = 0; index < variable_count; index++)
+    {
+      auto &neighbours = first_variables[index];
+
+      for (auto rule = grammar.first_rules[index]; rule < grammar.first_rules[index + 1]; rule++)
+        {
+          auto symbol = items.symbols_at_dot[items.first_items[rule]];
+          if (is_variable(symbol))
+            neighbours.push_back(symbol);
+        }
+
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+  auto is_visited = std::vector<bool>(variable_count, false);
+
+  items.closure_offsets.assign(1, 0);
+  items.closure_variables.clear();
+
+  for (size_t index = 0; index < variable_count; index++)
+    {
+      auto first = items.closure_variables.size();
+
+      items.closure_variables.push_back(SymbolType(index) + START_SYMBOL);
+      is_visited[index] = true;
 
-    return { .rule = rule,
-             .dot_index = index, };
+      for (auto i = first; i < items.closure_variables.size(); i++)
+        for (auto symbol: first_variables[items.closure_variables[i] - START_SYMBOL])
+          if (!is_visited[symbol - START_SYMBOL])
+            {
+              is_visited[symbol - START_SYMBOL] = true;
+              items.closure_variables.push_back(symbol);
+            }
+
+      for (auto i = first; i < items.closure_variables.size(); i++)
+        is_visited[items.closure_variables[i] - START_SYMBOL] = false;
+
+      items.closure_offsets.push_back(uint32_t(items.closure_variables.size()));
+    }
+}
+
+ItemTable
+intern_items(const Grammar &grammar)
+{
+  auto result = ItemTable{ };
+  result.grammar = &grammar;
+  auto positions = std::vector<Item>{ };
+  auto first_positions = std::vector<uint32_t>{ };
+
+  positions.reserve(grammar.symbols.size());
+  first_positions.reserve(grammar.rule_count());
+
+  for (RuleId id = 0; id < grammar.rule_count(); id++)
+    {
+      first_positions.push_back(uint32_t(positions.size()));
+
+      auto size = grammar.grab_rule(id).size();
+      for (uint32_t dot_index = 1; dot_index < size; dot_index++)
+        {
+          positions.push_back({
+              .rule = id,
+              .dot_index = dot_index,
+            });
+        }
+    }
+
+  auto const symbol_at_dot =
+    [&grammar](Item item) -> SymbolType
+    {
+      return grammar.symbols[grammar.rule_offsets[item.rule] + item.dot_index];
+    };
+
+  auto order = std::vector<uint32_t>(positions.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = uint32_t(i);
+
+  std::sort(order.begin(), order.end(),
+            [&positions, &symbol_at_dot](uint32_t left, uint32_t right) -> bool
+            {
+              auto litem = positions[left], ritem = positions[right];
+              auto lsymbol = symbol_at_dot(litem), rsymbol = symbol_at_dot(ritem);
+
+              if (lsymbol != rsymbol)
+                return lsymbol < rsymbol;
+              else if (litem.dot_index != ritem.dot_index)
+                return litem.dot_index < ritem.dot_index;
+              else
+                return litem.rule < ritem.rule;
+            });
+
+  auto ids = std::vector<ItemId>(positions.size());
+  for (size_t i = 0; i < order.size(); i++)
+    {
+      auto item = positions[order[i]];
+      ids[order[i]] = ItemId(i);
+      result.items.push_back(item);
+      result.symbols_at_dot.push_back(symbol_at_dot(item));
+    }
+
+  result.shifted_items.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); i++)
+    {
+      auto is_at_end = symbol_at_dot(positions[i]) == END_SYMBOL;
+      result.shifted_items[ids[i]] = is_at_end ? ids[i] : ids[i + 1];
+    }
+
+  for (auto position: first_positions)
+    result.first_items.push_back(ids[position]);
+
+  compute_variable_closures(result);
+
+  return result;
+}
+
+// Range of items in 'ParsingTable::arena'.
+struct ItemSpan
+{
+  uint32_t offset = 0;
+  uint32_t count = 0;
+};
+
+struct ItemRange
+{
+  const ItemId *first, *last;
+
+  const ItemId *begin() const
+  {
+    return first;
   }
 
-  bool operator==(const Item &other) const
+  const ItemId *end() const
   {
-    return this->dot_index == other.dot_index && this->rule == other.rule;
+    return last;
   }
 };
 
-struct ItemIsLess
-{
-  bool operator()(const Item &, const Item &) const;
-};
+// Set of terminals, indexed by 'unsigned char'. Terminal '\0' is the end of input.
+using TerminalSet = std::bitset<size_t(1) << (sizeof(TerminalType) * CHAR_BIT)>;
 
-using ItemSet = std::set<Item, ItemIsLess>;
+enum TableType
+  {
+    Table_LR0,
+    Table_SLR,
+    Table_LALR,
+  };
 
 struct State;
 
@@ -52,7 +198,9 @@ struct Action
 
     struct
     {
-      Grammar::Rule *to_rule;
+      RuleId rule;
+      // Terminals on which reduction is done. LR(0) reductions don't have lookaheads and are done on any terminal.
+      const TerminalSet *lookaheads;
     } reduce;
   } as;
 };
@@ -65,23 +213,61 @@ struct State
   constexpr static uint8_t HAS_REDUCE = 0x2;
   constexpr static uint8_t HAS_SHIFT_REDUCE = HAS_SHIFT | HAS_REDUCE;
 
-  ItemSet itemset;
+  ItemSpan itemset;
   // TODO: could seperate actions into two lists: one for shift and one for reduce actions. Also helps to check for shift/reduce and reduce/reduce conflicts.
   std::list<Action> actions;
   StateId id;
   uint8_t flags = 0;
+  // Items that weren't added by closure. Closure is determined by the kernel, so states are compared only by their kernels.
+  ItemSpan kernel = { };
 };
 
-using ParsingTable = std::list<State>;
+size_t
+hash_kernel(const std::vector<ItemId> &kernel)
+{
+  size_t hash = kernel.size();
+  for (auto item: kernel)
+    hash ^= item + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+
+  return hash;
+}
+
+struct ParsingTable
+{
+  ItemTable items;
+  // Item sets and kernels of all states, each one is sorted by item id.
+  std::vector<ItemId> arena;
+  std::list<State> states;
+  // Lookaheads of reduce actions, filled by 'compute_lookaheads'.
+  std::deque<TerminalSet> lookaheads;
+
+  ItemRange grab_items(ItemSpan span) const
+  {
+    auto first = arena.data() + span.offset;
+    return { first, first + span.count };
+  }
+
+  ItemSpan push_items(const std::vector<ItemId> &items)
+  {
+    auto span = ItemSpan{
+      .offset = uint32_t(arena.size()),
+      .count = uint32_t(items.size()),
+    };
+    arena.insert(arena.end(), items.begin(), items.end());
+
+    return span;
+  }
+};
 
 Action *
-find_action(Action::Type type, std::list<Action> &actions)
+find_reduce_action(std::list<Action> &actions, TerminalType lookahead)
 {
   for (auto &action: actions)
-    if (action.type == type)
+    if (action.type == Action::Reduce
+        && (!action.as.reduce.lookaheads || action.as.reduce.lookaheads->test((unsigned char)lookahead)))
       return &action;
 
-  assert(false);
+  return nullptr;
 }
 
 Action *
@@ -113,13 +299,65 @@ struct PDAState
   SymbolType symbol;
 };
 
+// Stack of a matcher that keeps its buffer between matches. Elements are never destroyed, so popping any number of them only moves the top.
+template <typename T>
+struct ParseStack
+{
+  std::vector<T> buffer = { };
+  size_t size = 0;
+
+  void clear()
+  {
+    size = 0;
+  }
+
+  void push(const T &value)
+  {
+    if (size == buffer.size())
+      buffer.resize(std::max(size_t(64), 2 * buffer.size()));
+
+    buffer[size++] = value;
+  }
+
+  void push(const T &value, size_t count)
+  {
+    if (size + count > buffer.size())
+      buffer.resize(std::max({ size_t(64), 2 * buffer.size(), size + count }));
+
+    std::fill_n(&buffer[size], count, value);
+    size += count;
+  }
+
+  void pop(size_t count)
+  {
+    assert(count <= size);
+    size -= count;
+  }
+
+  // Number of elements equal to 'value' at the top.
+  size_t count_top(const T &value) const
+  {
+    size_t count = 0;
+    while (count < size && buffer[size - 1 - count] == value)
+      count++;
+
+    return count;
+  }
+
+  T &top()
+  {
+    assert(size > 0);
+    return buffer[size - 1];
+  }
+};
+
 // 'shift' and 'goto' operations are supposed to be separate, but in this implementation they are the same.
 struct PDA
 {
   Grammar *grammar;
   ParsingTable *table;
 
-  std::stack<PDAState> stack = { };
+  ParseStack<PDAState> stack = { };
   const char *to_match = "";
   size_t consumed = 0;
   State *state = nullptr;
@@ -129,10 +367,9 @@ struct PDA
     assert(grammar && table);
 
     to_match = string;
-    auto empty = std::stack<PDAState>{ };
-    stack.swap(empty); // Remove all elements.
+    stack.clear();
     consumed = 0;
-    state = &table->front();
+    state = &table->states.front();
 
     stack.push({
         .state = state,
@@ -159,18 +396,15 @@ struct PDA
 
   PDAStepResult step()
   {
-    // TODO: need to check for reduce/reduce conflicts.
-    assert((state->flags & State::HAS_SHIFT_REDUCE) != State::HAS_SHIFT_REDUCE);
+    // Conflicts are rejected by 'compile_parsing_table', so the first suitable reduction is the only one.
+    auto reduce_action = (state->flags & State::HAS_REDUCE) ? find_reduce_action(state->actions, to_match[consumed]) : nullptr;
 
-    if (state->flags & State::HAS_REDUCE)
+    if (reduce_action)
       {
-        auto reduce_action = find_action(Action::Reduce, state->actions);
-        auto &rule = *reduce_action->as.reduce.to_rule;
-        auto symbol = rule[0];
+        auto rule = reduce_action->as.reduce.rule;
+        auto symbol = grammar->rule_variable(rule);
 
-        // Account for first symbol (variable definition) and last symbol (null terminator).
-        for (size_t i = rule.size() - 1 - 1; i-- > 0; )
-          stack.pop();
+        stack.pop(grammar->rule_length(rule));
 
         state = stack.top().state;
 
@@ -214,239 +448,147 @@ struct PDA
           }
       }
   }
-
-  void generate_automaton_steps_json(const char *string, const char *filepath)
-  {
-    reset(string);
-
-    auto result = std::string{ };
-    result.append("{\n    \"string\": \"");
-    result.append(to_match);
-    result.append("\",\n    \"actions\": [");
-
-    auto first_run = true;
-
-    do
-      {
-        if (!first_run)
-          result.append(",\n                ");
-
-        auto [action, type] = step();
-        switch (type)
-          {
-          case PDAStepResult::Reject:
-            {
-              result.append("{ \"type\": \"finish\", \"result\": 0 }]\n}");
-              goto finish;
-            }
-          case PDAStepResult::Accept:
-            {
-              result.append("{ \"type\": \"finish\", \"result\": 1 }]\n}");
-              goto finish;
-            }
-          case PDAStepResult::None:
-            switch (action->type)
-              {
-              case Action::Shift:
-                {
-                  result.append("{ \"type\": \"shift\" }");
-                }
-
-                break;
-              case Action::Reduce:
-                {
-                  auto &rule = *action->as.reduce.to_rule;
-                  result.append("{ \"type\": \"reduce\", \"to\": { \"symbol\": \"");
-                  result.append(grammar->grab_variable_name(rule[0]));
-                  result.append("\", \"size\": ");
-                  result.append(std::to_string(rule.size() - 1 - 1));
-                  result.append(" } }");
-                }
-
-                break;
-              }
-
-            break;
-          }
-
-        first_run = false;
-      }
-    while (true);
-  finish:
-    result.push_back('\n');
-
-    auto file = std::ofstream{ filepath, std::ofstream::trunc };
-    if (!file.is_open())
-      {
-        std::cerr << "error: failed to open '"
-                  << filepath
-                  << "'\n";
-        exit(EXIT_FAILURE);
-      }
-    file.write(&result[0], result.size());
-    file.close();
-  }
 };
 
-bool
-ItemIsLess::operator()(const Item &left, const Item &right) const
-{
-  auto lsymbol = left.symbol_at_dot();
-  auto rsymbol = right.symbol_at_dot();
-
-  if (lsymbol == rsymbol)
-    {
-      if (left.dot_index == right.dot_index)
-        return left.rule < right.rule;
-      else
-        return left.dot_index < right.dot_index;
-    }
-  else
-    {
-      return lsymbol < rsymbol;
-    }
-}
-
+// Computes sorted item set from sorted kernel. 'is_visited' must be false for every variable, and is left that way.
 void
-compute_closure(Grammar &grammar, ItemSet &itemset)
+compute_closure(const ItemTable &items, const std::vector<ItemId> &kernel, std::vector<ItemId> &itemset, std::vector<bool> &is_visited)
 {
-  using Iterator = typename std::set<SymbolType>::iterator;
-
-  // Keep track of order in which elements were inserted.
-  auto to_visit = std::set<SymbolType>{ };
-  auto order = std::list<Iterator>{ };
-
-  auto const insert =
-    [&to_visit, &order](SymbolType symbol) -> void
-    {
-      if (is_variable(symbol))
-        {
-          auto [it, was_inserted] = to_visit.insert(symbol);
-          if (was_inserted)
-            order.push_back(it);
-        }
-    };
+  itemset.assign(kernel.begin(), kernel.end());
+  auto closure_start = itemset.size();
 
-  for (auto &item: itemset)
-    insert(item.symbol_at_dot());
-
-  for (auto &sit: order)
+  // Items with dot at the start of the rule are never in the kernel (except for the start rule, which isn't used anywhere), so there are no duplicates.
+  for (auto item: kernel)
     {
-      auto symbol = *sit;
+      auto symbol = items.symbols_at_dot[item];
+      if (!is_variable(symbol) || is_visited[symbol - START_SYMBOL])
+        continue;
 
-      for (auto it = grammar.find_first_rule(symbol);
-           it != grammar.rules.end() && (*it)[0] == symbol;
-           it++)
+      auto index = symbol - START_SYMBOL;
+      for (auto i = items.closure_offsets[index]; i < items.closure_offsets[index + 1]; i++)
         {
-          auto item = Item{
-            .rule = (Grammar::Rule *)&(*it),
-            .dot_index = 1,
-          };
-          itemset.insert(item);
-          insert(item.symbol_at_dot());
+          auto variable_index = items.closure_variables[i] - START_SYMBOL;
+          if (is_visited[variable_index])
+            continue;
+
+          is_visited[variable_index] = true;
+          for (auto rule = items.grammar->first_rules[variable_index]; rule < items.grammar->first_rules[variable_index + 1]; rule++)
+            itemset.push_back(items.first_items[rule]);
         }
     }
+
+  // Every variable has at least one rule, so every visited variable defines some of the added items.
+  for (auto i = closure_start; i < itemset.size(); i++)
+    is_visited[items.grammar->rule_variable(items.items[itemset[i]].rule) - START_SYMBOL] = false;
+
+  std::sort(itemset.begin(), itemset.end());
 }
 
 ParsingTable
 compute_parsing_table(Grammar &grammar)
 {
-  assert(!grammar.rules.empty());
+  assert(grammar.rule_count() > 0);
 
   auto table = ParsingTable{ };
+  table.items = intern_items(grammar);
+
+  auto &items = table.items;
+  auto states_by_kernel = std::unordered_multimap<size_t, State *>{ };
+  auto is_visited = std::vector<bool>(grammar.variable_count(), false);
+  auto kernel = std::vector<ItemId>{ };
+  auto itemset = std::vector<ItemId>{ };
   StateId next_state_id = 0;
 
+  // Expects sorted kernel of the state. Closure is computed only if the state wasn't seen before.
   auto const insert =
-    [&table, &next_state_id](State &&state) -> State *
+    [&table, &items, &states_by_kernel, &is_visited, &itemset, &next_state_id](const std::vector<ItemId> &kernel) -> State *
     {
-      State *state_ptr = nullptr;
+      auto kernel_hash = hash_kernel(kernel);
 
-      for (auto &self: table)
+      auto [it, last] = states_by_kernel.equal_range(kernel_hash);
+      for (; it != last; it++)
         {
-          if (self.itemset == state.itemset)
-            {
-              state_ptr = &self;
-              break;
-            }
+          auto other = table.grab_items(it->second->kernel);
+          if (std::equal(other.begin(), other.end(), kernel.begin(), kernel.end()))
+            return it->second;
         }
 
-      if (state_ptr == nullptr)
-        {
-          table.push_back(state);
-          next_state_id++;
-          state_ptr = &table.back();
-        }
+      compute_closure(items, kernel, itemset, is_visited);
 
-      return state_ptr;
-    };
+      auto state = State{
+        .itemset = table.push_items(itemset),
+        .actions = { },
+        .id = next_state_id++,
+        .flags = 0,
+        .kernel = table.push_items(kernel),
+      };
+      table.states.push_back(std::move(state));
 
-  {
-    auto item = Item{
-      .rule = (Grammar::Rule *)&(*grammar.rules.begin()),
-      .dot_index = 1,
-    };
-    auto state = State{
-      .itemset = { },
-      .actions = { },
-      .id = next_state_id,
+      auto state_ptr = &table.states.back();
+      states_by_kernel.emplace(kernel_hash, state_ptr);
+
+      return state_ptr;
     };
-    state.itemset.insert(item);
-    compute_closure(grammar, state.itemset);
 
-    insert(std::move(state));
-  }
+  // Start rule is the first rule, because '<start>' is the smallest variable.
+  kernel.assign(1, items.first_items[0]);
+  insert(kernel);
 
-  for (auto &state: table)
+  for (auto &state: table.states)
     {
-      auto &itemset = state.itemset;
-      auto it = itemset.begin();
+      auto span = state.itemset;
+      size_t i = 0;
+
+      // Arena can be reallocated by 'insert', so items are accessed by index.
+      auto const symbol_at =
+        [&table, &items, span](size_t i) -> SymbolType
+        {
+          return items.symbols_at_dot[table.arena[span.offset + i]];
+        };
 
-      while (it != itemset.end())
+      while (i < span.count)
         {
-          if (it->symbol_at_dot() == END_SYMBOL)
+          auto symbol = symbol_at(i);
+
+          if (symbol == END_SYMBOL)
             {
-              auto &actions = state.actions;
               do
                 {
+                  auto item = items.items[table.arena[span.offset + i]];
+
                   state.flags |= State::HAS_REDUCE;
                   auto action = Action{
                     .type = Action::Reduce,
                     .as = { .reduce = {
-                        .to_rule = it->rule,
+                        .rule = item.rule,
+                        .lookaheads = nullptr,
                       } },
                   };
-                  actions.push_back(action);
-                  it++;
+                  state.actions.push_back(action);
+                  i++;
                 }
-              while (it != itemset.end() && it->symbol_at_dot() == END_SYMBOL);
+              while (i < span.count && symbol_at(i) == END_SYMBOL);
             }
-
-          while (it != itemset.end())
+          else
             {
-              auto shift_symbol = it->symbol_at_dot();
-              auto new_state = State{
-                .itemset = { },
-                .actions = { },
-                .id = next_state_id,
-              };
+              kernel.clear();
 
               do
                 {
-                  new_state.itemset.insert(it->shift_dot());
-                  it++;
+                  kernel.push_back(items.shifted_items[table.arena[span.offset + i]]);
+                  i++;
                 }
-              while (it != itemset.end()
-                     && it->symbol_at_dot() == shift_symbol);
+              while (i < span.count && symbol_at(i) == symbol);
 
-              compute_closure(grammar, new_state.itemset);
+              std::sort(kernel.begin(), kernel.end());
 
-              auto where_to_transition = insert(std::move(new_state));
+              auto where_to_transition = insert(kernel);
 
               state.flags |= State::HAS_SHIFT;
               auto action = Action{
                 .type = Action::Shift,
                 .as = { .shift = {
-                    .label = shift_symbol,
+                    .label = symbol,
                     .item = where_to_transition,
                   } },
               };
@@ -465,7 +607,7 @@ generate_automaton_json(ParsingTable &table, const char *filepath)
   result.push_back('[');
 
   size_t i = 0;
-  for (auto &state: table)
+  for (auto &state: table.states)
     {
       assert(state.id == i++);
       result.push_back('[');
@@ -488,7 +630,7 @@ generate_automaton_json(ParsingTable &table, const char *filepath)
 
       result.push_back(']');
 
-      if (i < table.size())
+      if (i < table.states.size())
         result.append(", ");
     }
 
@@ -1,9 +1,19 @@
+// Terminal as it's printed. End of input is '\0', so it's written as an escape instead of a raw null byte.
+std::string
+terminal_to_string(SymbolType symbol)
+{
+  if (symbol == '\0')
+    return "\\0";
+
+  return std::string(1, (TerminalType)symbol);
+}
+
 std::string
 rule_to_string(Grammar &grammar, const Grammar::Rule &rule)
 {
   assert(rule.size() > 0 && is_variable(rule[0]));
 
-  auto result = grammar.grab_variable_name(rule[0]);
+  auto result = std::string{ grammar.grab_variable_name(rule[0]) };
   result.append(": ");
 
   for (size_t i = 1; i + 1 < rule.size(); i++)
@@ -12,7 +22,7 @@ rule_to_string(Grammar &grammar, const Grammar::Rule &rule)
       if (is_variable(symbol))
         result.append(grammar.grab_variable_name(symbol));
       else
-        result.push_back((TerminalType)symbol);
+        result.append(terminal_to_string(symbol));
     }
 
   return result;
@@ -22,15 +32,15 @@ void
 print_grammar(Grammar &grammar)
 {
   std::cout << "\nAugmented grammar:\n";
-  for (auto &rule: grammar.rules)
-    std::cout << "    " << rule_to_string(grammar, rule) << '\n';
+  for (RuleId rule = 0; rule < grammar.rule_count(); rule++)
+    std::cout << "    " << rule_to_string(grammar, grammar.grab_rule(rule)) << '\n';
   std::cout << '\n';
 }
 
 void
 print_pushdown_automaton(Grammar &grammar, ParsingTable &table)
 {
-  for (auto &state: table)
+  for (auto &state: table.states)
     {
       std::cout << "State " << state.id << ":\n    ";
       for (auto &actions: state.actions)
@@ -40,8 +50,16 @@ print_pushdown_automaton(Grammar &grammar, ParsingTable &table)
             case Action::Reduce:
               {
                 std::cout << "r("
-                          << rule_to_string(grammar, *actions.as.reduce.to_rule)
+                          << rule_to_string(grammar, grammar.grab_rule(actions.as.reduce.rule))
                           << ")";
+
+                if (auto lookaheads = actions.as.reduce.lookaheads)
+                  {
+                    std::cout << " on";
+                    for (size_t terminal = 0; terminal < lookaheads->size(); terminal++)
+                      if (lookaheads->test(terminal))
+                        std::cout << " '" << terminal_to_string(SymbolType(terminal)) << "'";
+                  }
               }
 
               break;
@@ -52,7 +70,7 @@ print_pushdown_automaton(Grammar &grammar, ParsingTable &table)
                 if (is_variable(symbol))
                   std::cout << grammar.grab_variable_name(symbol);
                 else
-                  std::cout << "'" << (TerminalType)symbol << "'";
+                  std::cout << "'" << terminal_to_string(symbol) << "'";
 
                 std::cout << " -> "
                           << actions.as.shift.item->id;
@@ -66,23 +84,26 @@ print_pushdown_automaton(Grammar &grammar, ParsingTable &table)
 
       std::cout << '\n';
 
-      for (auto &item: state.itemset)
+      for (auto id: table.grab_items(state.itemset))
         {
-          std::cout << grammar.grab_variable_name((*item.rule)[0])
+          auto item = table.items.items[id];
+          auto rule = grammar.grab_rule(item.rule);
+
+          std::cout << grammar.grab_variable_name(rule[0])
                     << ": ";
 
           size_t i = 1;
-          for (; i + 1 < item.rule->size(); i++)
+          for (; i + 1 < rule.size(); i++)
             {
               if (i == item.dot_index)
                 std::cout << '.';
 
-              auto symbol = (*item.rule)[i];
+              auto symbol = rule[i];
 
               if (is_variable(symbol))
                 std::cout << grammar.grab_variable_name(symbol);
               else
-                std::cout << (TerminalType)symbol;
+                std::cout << terminal_to_string(symbol);
             }
 
           if (i == item.dot_index)
@@ -94,3 +115,98 @@ print_pushdown_automaton(Grammar &grammar, ParsingTable &table)
       std::cout << '\n';
     }
 }
+
+void
+print_table_stats(const CompiledTable &table)
+{
+  auto dense_actions = table.unmerged_state_count * TERMINAL_COLUMN_COUNT;
+  auto dense_gotos = table.unmerged_state_count * table.variable_count;
+  auto dense_size = sizeof(ActionCode) * dense_actions + sizeof(StateId) * dense_gotos;
+
+  std::cout << "Table statistics:\n"
+            << "    states: " << table.state_count << " (" << table.unmerged_state_count << " before merging)\n"
+            << "    variables: " << table.variable_count << ", rules: " << table.rule_count << '\n'
+            << "    columns: " << table.column_count << " classes of " << END_OF_INPUT_COLUMN << " bytes and end of input\n"
+            << "    action entries: " << table.action_entry_count << " (" << dense_actions << " in dense table)\n"
+            << "    goto entries: " << table.goto_entry_count << " (" << dense_gotos << " in dense table)\n"
+            << "    size: " << table.packed().size() << " bytes (" << dense_size << " bytes of dense actions and gotos)\n";
+}
+
+// Writes the tree as nested JSON objects: nodes have their variable, rule, covered bytes and children, and terminals are strings. Tree is walked without recursion, because right recursion makes trees as deep as the input is long, and output is written in blocks as it's generated.
+void
+generate_parse_tree_json(const ParseTree &tree, const CompiledTable &table, const char *filepath)
+{
+  auto file = std::ofstream{ filepath, std::ofstream::trunc };
+  if (!file.is_open())
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+
+  auto result = std::string{ };
+  // Nodes whose children are being written, with the number of children written so far.
+  auto path = std::vector<std::pair<uint32_t, uint32_t>>{ };
+
+  auto const open_node =
+    [&tree, &table, &result, &path](uint32_t index) -> void
+    {
+      auto &node = tree.nodes[index];
+
+      result.append("{ \"variable\": ");
+      append_json_string(result, table.variable_name(node.variable));
+      result.append(", \"rule\": ");
+      result.append(std::to_string(node.rule));
+      result.append(", \"start\": ");
+      result.append(std::to_string(node.start));
+      result.append(", \"end\": ");
+      result.append(std::to_string(node.end));
+      result.append(", \"children\": [");
+
+      path.push_back({ index, 0 });
+    };
+
+  if (tree.root != NO_NODE)
+    open_node(tree.root);
+  else
+    result.append("null");
+
+  while (!path.empty())
+    {
+      if (result.size() >= BATCH_BUFFER_SIZE)
+        {
+          file.write(&result[0], result.size());
+          result.clear();
+        }
+
+      auto [index, written] = path.back();
+      auto &node = tree.nodes[index];
+
+      if (written == node.child_count)
+        {
+          result.append("] }");
+          path.pop_back();
+          continue;
+        }
+
+      if (written > 0)
+        result.append(", ");
+
+      path.back().second++;
+
+      auto child = tree.children[node.first_child + written];
+      if (ParseTree::is_terminal(child))
+        {
+          auto byte = (char)ParseTree::terminal(child);
+          append_json_string(result, { &byte, 1 });
+        }
+      else
+        open_node(child);
+    }
+
+  result.push_back('\n');
+
+  file.write(&result[0], result.size());
+  file.close();
+}
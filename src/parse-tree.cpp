@@ -0,0 +1,165 @@
+constexpr uint32_t NO_NODE = UINT32_MAX;
+// Children of a node are either other nodes or terminals, terminals have this bit set and their byte in the low bits.
+constexpr uint32_t TERMINAL_CHILD = uint32_t(1) << 31;
+
+constexpr char TREE_MAGIC[8] = { 'L', 'R', 'T', 'R', 'E', 'E', '\0', '\0' };
+constexpr uint32_t TREE_VERSION = 1;
+constexpr uint32_t TREE_BYTE_ORDER = 0x01020304;
+
+// Node of a variable, made by reduction by 'rule'. Bytes of the input that it covers are '[start, end)'.
+struct ParseNode
+{
+  SymbolType variable;
+  RuleId rule;
+  uint32_t first_child;  // Children are '[first_child, first_child + child_count)' in 'ParseTree::children'.
+  uint32_t child_count;
+  uint64_t start;
+  uint64_t end;
+};
+
+struct ChildRange
+{
+  const uint32_t *first, *last;
+
+  const uint32_t *begin() const
+  {
+    return first;
+  }
+
+  const uint32_t *end() const
+  {
+    return last;
+  }
+};
+
+// Saved tree starts with this header, followed by nodes and children.
+struct TreeHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t node_count;
+  uint32_t child_count;
+  uint32_t root;
+  uint32_t reserved;
+};
+
+// Parse tree built by 'TableMatcher' during reductions. Nodes and children are appended to arrays that keep their capacity between parses, so nodes are never allocated one by one, and children of every node are one contiguous span. Nodes are stored in the order of reductions, so children always come before their parent.
+//
+// Terminals don't have nodes, they are stored only as children. Position of a terminal is the end of its previous sibling, or the start of its parent.
+struct ParseTree
+{
+  struct PendingChild
+  {
+    uint32_t child;
+    uint64_t start;
+  };
+
+  std::vector<ParseNode> nodes = { };
+  std::vector<uint32_t> children = { };
+  uint32_t root = NO_NODE;  // Set only if the input was accepted.
+
+  // Symbols on the parsing stack that aren't children of any node yet.
+  ParseStack<PendingChild> pending = { };
+  uint64_t position = 0;
+
+  static bool is_terminal(uint32_t child)
+  {
+    return child & TERMINAL_CHILD;
+  }
+
+  static unsigned char terminal(uint32_t child)
+  {
+    return (unsigned char)(child & ~TERMINAL_CHILD);
+  }
+
+  ChildRange grab_children(const ParseNode &node) const
+  {
+    auto first = children.data() + node.first_child;
+    return { first, first + node.child_count };
+  }
+
+  void clear()
+  {
+    nodes.clear();
+    children.clear();
+    root = NO_NODE;
+    pending.clear();
+    position = 0;
+  }
+
+  void shift(unsigned char byte)
+  {
+    pending.push({
+        .child = TERMINAL_CHILD | byte,
+        .start = position++,
+      });
+  }
+
+  void shift(const char *bytes, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+      shift((unsigned char)bytes[i]);
+  }
+
+  // Children of the node are the last 'length' symbols on the stack. Everything shifted so far is covered by them, so the node ends at the current position.
+  void reduce(RuleId rule, SymbolType variable, uint32_t length)
+  {
+    assert(nodes.size() < TERMINAL_CHILD && children.size() + length <= UINT32_MAX);
+
+    auto first = pending.buffer.data() + pending.size - length;
+    auto node = ParseNode{
+      .variable = variable,
+      .rule = rule,
+      .first_child = uint32_t(children.size()),
+      .child_count = length,
+      .start = length > 0 ? first->start : position,
+      .end = position,
+    };
+
+    for (uint32_t i = 0; i < length; i++)
+      children.push_back(first[i].child);
+
+    pending.pop(length);
+    pending.push({
+        .child = uint32_t(nodes.size()),
+        .start = node.start,
+      });
+    nodes.push_back(node);
+  }
+
+  // Accepted input leaves only the start variable on the stack. Anything else is left only by a corrupted loaded table, and then there's no tree.
+  void finish(bool is_accepted)
+  {
+    if (is_accepted && pending.size == 1 && !(pending.top().child & TERMINAL_CHILD))
+      root = pending.top().child;
+  }
+};
+
+void
+save_parse_tree(const ParseTree &tree, const char *filepath)
+{
+  auto header = TreeHeader{
+    .magic = { },
+    .version = TREE_VERSION,
+    .byte_order = TREE_BYTE_ORDER,
+    .node_count = uint32_t(tree.nodes.size()),
+    .child_count = uint32_t(tree.children.size()),
+    .root = tree.root,
+    .reserved = 0,
+  };
+  memcpy(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC));
+
+  auto file = std::ofstream{ filepath, std::ofstream::binary | std::ofstream::trunc };
+  if (!file.is_open())
+    {
+      std::cerr << "error: failed to open '"
+                << filepath
+                << "'\n";
+      exit(EXIT_FAILURE);
+    }
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)tree.nodes.data(), std::streamsize(sizeof(ParseNode) * tree.nodes.size()));
+  file.write((const char *)tree.children.data(), std::streamsize(sizeof(uint32_t) * tree.children.size()));
+  file.close();
+}
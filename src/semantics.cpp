@@ -0,0 +1,85 @@
+// Value of a symbol computed by semantic actions. Values of terminals are their bytes in 'integer'.
+union SemanticValue
+{
+  int64_t integer;
+  double real;
+  void *pointer;
+};
+
+// Computes value of the variable from 'values' of the symbols on the right side of the rule.
+using SemanticAction = SemanticValue (*)(void *context, const SemanticValue *values, size_t count);
+
+// Id of 'rule' in 'grammar', which is also its id in tables compiled from it. Like rules in 'Grammar::symbols', 'rule' starts with its variable and ends with 'END_SYMBOL'.
+RuleId
+find_rule_id(const Grammar &grammar, const std::vector<SymbolType> &rule)
+{
+  assert(rule.size() >= 2 && is_variable(rule[0]));
+
+  auto index = rule[0] - START_SYMBOL;
+  for (auto id = grammar.first_rules[index]; id < grammar.first_rules[index + 1]; id++)
+    {
+      auto other = grammar.grab_rule(id);
+      if (std::equal(other.begin(), other.end(), rule.begin(), rule.end()))
+        return id;
+    }
+
+  assert(false && "rule is not in the grammar");
+  return 0;
+}
+
+// Evaluates the input during matching, without building a tree. 'TableMatcher' calls the action of every rule it reduces by, with values kept on a stack next to the stack of states. Rules without an action take the value of their first symbol, or zero if they are empty.
+//
+// Reductions skipped by 'add_reduce_shortcuts' don't call actions, so tables for semantic actions are compiled without shortcuts.
+struct SemanticActions
+{
+  std::vector<SemanticAction> actions = { };  // Indexed by rule id, null if the rule has no action.
+  void *context = nullptr;                    // Passed to every action.
+  SemanticValue result = { };                 // Value of the start variable, set if the input was accepted.
+
+  ParseStack<SemanticValue> values = { };
+
+  void set(RuleId rule, SemanticAction action)
+  {
+    if (rule >= actions.size())
+      actions.resize(rule + 1, nullptr);
+
+    actions[rule] = action;
+  }
+
+  void clear()
+  {
+    values.clear();
+    result = { };
+  }
+
+  void shift(unsigned char byte)
+  {
+    values.push({ .integer = byte });
+  }
+
+  void shift(const char *bytes, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+      shift((unsigned char)bytes[i]);
+  }
+
+  void reduce(RuleId rule, SymbolType, uint32_t length)
+  {
+    auto first = values.buffer.data() + values.size - length;
+    auto value = SemanticValue{ };
+
+    if (rule < actions.size() && actions[rule])
+      value = actions[rule](context, first, length);
+    else if (length > 0)
+      value = first[0];
+
+    values.pop(length);
+    values.push(value);
+  }
+
+  void finish(bool is_accepted)
+  {
+    if (is_accepted)
+      result = values.top();
+  }
+};
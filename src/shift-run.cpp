@@ -0,0 +1,78 @@
+constexpr uint32_t NO_RUN = UINT32_MAX;
+constexpr size_t RUN_MAX_LISTED_BYTES = 8;
+
+// Bytes that a state shifts back to itself, like 'a' in the state of 'A: a . A' with 'A: a A'. While the next byte is one of them, the matcher only pushes the same state, so such runs are consumed at once.
+struct ShiftRun
+{
+  uint64_t bits[4];
+  uint8_t bytes[RUN_MAX_LISTED_BYTES];  // Same bytes as a list, when there are few enough of them to compare them with SIMD.
+  uint32_t byte_count;                  // Zero if there are too many bytes, and only 'bits' is set.
+  uint32_t reserved;
+
+  bool contains(unsigned char byte) const
+  {
+    return (bits[byte / 64] >> (byte % 64)) & 1;
+  }
+};
+
+ShiftRun
+make_shift_run(const std::bitset<256> &bytes)
+{
+  auto result = ShiftRun{ };
+
+  for (size_t byte = 0; byte < bytes.size(); byte++)
+    if (bytes.test(byte))
+      result.bits[byte / 64] |= uint64_t(1) << (byte % 64);
+
+  if (bytes.count() <= RUN_MAX_LISTED_BYTES)
+    for (size_t byte = 0; byte < bytes.size(); byte++)
+      if (bytes.test(byte))
+        result.bytes[result.byte_count++] = uint8_t(byte);
+
+  return result;
+}
+
+// Returns the number of bytes at the start of 'data' that belong to 'run'. Listed bytes are compared with a block of input at once, with AVX2 or SSE2 when the compiler targets them.
+size_t
+scan_shift_run(const ShiftRun &run, const char *data, size_t size)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  if (run.byte_count > 0)
+    for (; i + 32 <= size; i += 32)
+      {
+        auto block = _mm256_loadu_si256((const __m256i *)(data + i));
+        auto matches = _mm256_setzero_si256();
+
+        for (uint32_t j = 0; j < run.byte_count; j++)
+          matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(char(run.bytes[j]))));
+
+        auto mismatches = ~uint32_t(_mm256_movemask_epi8(matches));
+        if (mismatches != 0)
+          return i + size_t(__builtin_ctz(mismatches));
+      }
+#endif
+
+#if defined(__SSE2__)
+  if (run.byte_count > 0)
+    for (; i + 16 <= size; i += 16)
+      {
+        auto block = _mm_loadu_si128((const __m128i *)(data + i));
+        auto matches = _mm_setzero_si128();
+
+        for (uint32_t j = 0; j < run.byte_count; j++)
+          matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm_set1_epi8(char(run.bytes[j]))));
+
+        auto mismatches = ~uint32_t(_mm_movemask_epi8(matches)) & 0xffff;
+        if (mismatches != 0)
+          return i + size_t(__builtin_ctz(mismatches));
+      }
+#endif
+
+  for (; i < size; i++)
+    if (!run.contains((unsigned char)data[i]))
+      break;
+
+  return i;
+}
@@ -0,0 +1,192 @@
+// Gets shifts and reductions of 'TableMatcher' that only matches, and does nothing with them. 'ParseTree', 'SemanticActions' and 'TraceWriter' get them in the same way.
+struct NoListener
+{
+  void clear()
+  {
+  }
+
+  void shift(unsigned char)
+  {
+  }
+
+  void shift(const char *, size_t)
+  {
+  }
+
+  void reduce(RuleId, SymbolType, uint32_t)
+  {
+  }
+
+  void finish(bool)
+  {
+  }
+};
+
+// Matcher that runs only on 'CompiledTable'. Stack is kept between calls to avoid reallocations.
+//
+// Input can be given at once with 'match', or in chunks with 'reset', 'feed' and 'finish'. State of the parser is kept between chunks, so a stream is matched in memory bounded by the depth of the stack rather than by its size.
+//
+// If one of 'tree', 'semantics' or 'trace' is set, shifts and reductions also build the parse tree, evaluate semantic actions or are written to the trace. Reductions skipped by 'add_reduce_shortcuts' are never seen by them, so their tables are compiled without shortcuts.
+struct TableMatcher
+{
+  const CompiledTable *table;
+  ParseTree *tree = nullptr;
+  SemanticActions *semantics = nullptr;
+  TraceWriter *trace = nullptr;
+
+  ParseStack<StateId> stack = { };
+  StateId state = 0;
+  bool is_rejected = false;
+
+  void reset()
+  {
+    assert(table && (tree != nullptr) + (semantics != nullptr) + (trace != nullptr) <= 1);
+
+    stack.clear();
+    stack.push(0);
+    state = 0;
+    is_rejected = false;
+
+    if (tree)
+      tree->clear();
+    if (semantics)
+      semantics->clear();
+    if (trace)
+      trace->clear();
+  }
+
+  // Does all reductions on 'column' and then shifts it. Returns false on error. For end of input returns true if the string is accepted.
+  //
+  // Every listener has its own instance, so that matching alone doesn't check for listeners at every step.
+  template <typename Listener>
+  bool advance(size_t column, Listener *listener)
+  {
+    do
+      {
+        auto code = table->action(state, column);
+
+        if (code > 0)
+          {
+            state = decode_shift(code);
+            stack.push(state);
+            listener->shift((unsigned char)column);
+            return true;
+          }
+        else if (code == ACTION_ERROR)
+          return false;
+        else if (code == ACTION_ACCEPT)
+          return true;
+        else
+          {
+            auto rule = decode_reduce(code);
+            auto length = table->rule_lengths[rule];
+
+            // Only a corrupted loaded table pops the whole stack, see 'has_valid_table_arrays'.
+            if (length >= stack.size)
+              return false;
+
+            stack.pop(length);
+
+            auto exposed = stack.top();
+            auto next = table->go(exposed, table->rule_variables[rule]);
+            assert(next != NO_STATE);
+
+            listener->reduce(rule, table->rule_variables[rule], length);
+
+            // Right recursion like 'A: a A' leaves copies of one state under 'state', for example after a run. If the goto leads back to 'state', the same reduction repeats and removes one copy each time, until another state is exposed. Listeners see every one of these reductions, so they are collapsed only without them.
+            if (std::is_same_v<Listener, NoListener> && length == 2 && next == state)
+              stack.pop(stack.count_top(exposed) - 1);
+
+            state = next;
+            stack.push(state);
+          }
+      }
+    while (true);
+  }
+
+  template <typename Listener>
+  bool feed_chunk(const char *chunk, size_t size, Listener *listener)
+  {
+    for (size_t i = 0; i < size; i++)
+      {
+        if (!advance((unsigned char)chunk[i], listener))
+          {
+            is_rejected = true;
+            return false;
+          }
+
+        // After a shift into a state with a run, following bytes of the run only push the same state.
+        if (auto run = table->state_runs[state]; run != NO_RUN)
+          {
+            auto count = scan_shift_run(table->runs[run], chunk + i + 1, size - i - 1);
+            stack.push(state, count);
+            listener->shift(chunk + i + 1, count);
+            i += count;
+          }
+      }
+
+    return true;
+  }
+
+  template <typename Listener>
+  bool finish_with(Listener *listener)
+  {
+    auto result = !is_rejected && advance(END_OF_INPUT_COLUMN, listener);
+    listener->finish(result);
+
+    return result;
+  }
+
+  // Matches next part of the input. Returns false as soon as the input given so far can't start an accepted string, the rest of the input is ignored after that.
+  bool feed(const char *chunk, size_t size)
+  {
+    auto listener = NoListener{ };
+
+    if (is_rejected)
+      return false;
+    else if (tree)
+      return feed_chunk(chunk, size, tree);
+    else if (semantics)
+      return feed_chunk(chunk, size, semantics);
+    else if (trace)
+      return feed_chunk(chunk, size, trace);
+    else
+      return feed_chunk(chunk, size, &listener);
+  }
+
+  // Ends the input. Returns true if all input given to 'feed' since the last 'reset' is accepted.
+  bool finish()
+  {
+    auto listener = NoListener{ };
+
+    if (tree)
+      return finish_with(tree);
+    else if (semantics)
+      return finish_with(semantics);
+    else if (trace)
+      return finish_with(trace);
+    else
+      return finish_with(&listener);
+  }
+
+  bool match(const char *string, size_t size)
+  {
+    auto listener = NoListener{ };
+
+    reset();
+
+    if (tree || semantics || trace)
+      {
+        feed(string, size);
+        return finish();
+      }
+
+    feed_chunk(string, size, &listener);
+    return finish_with(&listener);
+  }
+
+  bool match(const char *string)
+  {
+    return match(string, strlen(string));
+  }
+};
@@ -20,9 +20,59 @@ struct Token
 
   Type type;
   std::string_view text;
-  LineInfo line_info;
+  size_t offset;  // Line and column are found with 'locate' only when they are needed for an error.
 };
 
+// Classes of characters used by tokenizers, a character can be in several of them.
+constexpr uint8_t CHAR_SPACE = 0x1;
+constexpr uint8_t CHAR_UPPER = 0x2;
+constexpr uint8_t CHAR_VARIABLE = 0x4;          // Continues a name of variable in custom form.
+constexpr uint8_t CHAR_ENDS_TERMINALS = 0x8;    // Ends a sequence of terminals in custom form, unless it's escaped.
+constexpr uint8_t CHAR_ESCAPABLE = 0x10;        // Can be escaped in custom form.
+constexpr uint8_t CHAR_ESCAPABLE_BNF = 0x20;    // Can be escaped in a string in Backus-Naur form.
+constexpr uint8_t CHAR_SPECIAL_BNF = 0x40;      // Ends or escapes a string in Backus-Naur form.
+constexpr uint8_t CHAR_BACKSLASH = 0x80;
+
+struct CharClasses
+{
+  uint8_t values[256];
+
+  constexpr uint8_t operator[](char ch) const
+  {
+    return values[(unsigned char)ch];
+  }
+};
+
+constexpr CharClasses
+compute_char_classes()
+{
+  auto result = CharClasses{ };
+
+  for (auto ch: std::string_view{ " \t\n\v\f\r" })
+    result.values[(unsigned char)ch] |= CHAR_SPACE;
+
+  for (int ch = 'A'; ch <= 'Z'; ch++)
+    result.values[ch] |= CHAR_UPPER | CHAR_VARIABLE | CHAR_ENDS_TERMINALS | CHAR_ESCAPABLE;
+  for (int ch = 'a'; ch <= 'z'; ch++)
+    result.values[ch] |= CHAR_VARIABLE;
+  for (int ch = '0'; ch <= '9'; ch++)
+    result.values[ch] |= CHAR_VARIABLE;
+
+  for (auto ch: std::string_view{ "'-_" })
+    result.values[(unsigned char)ch] |= CHAR_VARIABLE;
+
+  for (auto ch: std::string_view{ ":;| " })
+    result.values[(unsigned char)ch] |= CHAR_ENDS_TERMINALS | CHAR_ESCAPABLE;
+
+  result.values[(unsigned char)'\\'] |= CHAR_ESCAPABLE | CHAR_ESCAPABLE_BNF | CHAR_SPECIAL_BNF | CHAR_BACKSLASH;
+  result.values[(unsigned char)'\"'] |= CHAR_ESCAPABLE_BNF | CHAR_SPECIAL_BNF;
+  result.values[0] |= CHAR_ENDS_TERMINALS | CHAR_SPECIAL_BNF;
+
+  return result;
+}
+
+constexpr CharClasses char_classes = compute_char_classes();
+
 struct TokenizerContext
 {
   constexpr static uint8_t LOOKAHEAD = 2;
@@ -30,103 +80,131 @@ struct TokenizerContext
   Token tokens_buffer[LOOKAHEAD] = { };
   uint8_t token_start = 0;
   uint8_t token_count = 0;
-  LineInfo line_info = { };
+  size_t offset = 0;
   const char *source;
+  const char *source_end;  // Source isn't required to end with '\0', like a mapped file.
 };
 
-void
-advance_line_info(TokenizerContext &ctx, char ch)
+// Line and column of 'offset', counted from the start of the source. Only errors need them, so they aren't tracked while tokenizing.
+LineInfo
+locate(const TokenizerContext &ctx, size_t offset)
 {
-  ++ctx.line_info.offset;
-  ++ctx.line_info.column;
-  if (ch == '\n')
+  auto result = LineInfo{
+    .offset = offset,
+  };
+
+  auto at = ctx.source;
+  auto last = ctx.source + offset;
+  while (auto new_line = (const char *)memchr(at, '\n', size_t(last - at)))
     {
-      ++ctx.line_info.line;
-      ctx.line_info.column = 1;
+      result.line++;
+      at = new_line + 1;
     }
+
+  result.column = size_t(last - at) + 1;
+
+  return result;
+}
+
+// Character at 'at', or '\0' at the end of the source.
+char
+char_at(const TokenizerContext &ctx, const char *at)
+{
+  return at < ctx.source_end ? *at : '\0';
+}
+
+const char *
+skip_chars(const TokenizerContext &ctx, const char *at, uint8_t classes)
+{
+  while (at < ctx.source_end && (char_classes[*at] & classes))
+    at++;
+
+  return at;
+}
+
+const char *
+skip_other_chars(const TokenizerContext &ctx, const char *at, uint8_t classes)
+{
+  while (at < ctx.source_end && !(char_classes[*at] & classes))
+    at++;
+
+  return at;
 }
 
 void
-advance_line_info_assume_no_new_line(TokenizerContext &ctx, size_t count)
+push_token(TokenizerContext &ctx, const Token &token, const char *at)
 {
-  ctx.line_info.offset += count;
-  ctx.line_info.column += count;
+  ctx.offset = size_t(at - ctx.source);
+
+  assert(ctx.token_count < ctx.LOOKAHEAD);
+  uint8_t index = (ctx.token_start + ctx.token_count) % ctx.LOOKAHEAD;
+  ctx.tokens_buffer[index] = token;
+  ctx.token_count++;
 }
 
 void
 buffer_token_custom(TokenizerContext &ctx)
 {
   auto failed_to_tokenize = false;
-  auto at = &ctx.source[ctx.line_info.offset];
-
-  while (isspace(*at))
-    advance_line_info(ctx, *at++);
+  auto at = skip_chars(ctx, ctx.source + ctx.offset, CHAR_SPACE);
 
   auto token = Token{
     .type = Token::End_Of_File,
     .text = { at, 0 },
-    .line_info = ctx.line_info,
+    .offset = size_t(at - ctx.source),
   };
 
-  switch (*at)
+  switch (char_at(ctx, at))
     {
     case '\0':
+      if (at < ctx.source_end)
+        {
+          failed_to_tokenize = true;
+          PRINT_ERROR0(locate(ctx, token.offset), "unexpected null character");
+        }
+
       break;
     case ':':
       token.type = Token::Define;
-      token.text = { token.text.data(), 1 };
-      advance_line_info(ctx, *at++);
+      token.text = { at++, 1 };
       break;
     case ';':
       token.type = Token::Delimiter;
-      token.text = { token.text.data(), 1 };
-      advance_line_info(ctx, *at++);
+      token.text = { at++, 1 };
       break;
     case '|':
       token.type = Token::Bar;
-      token.text = { token.text.data(), 1 };
-      advance_line_info(ctx, *at++);
+      token.text = { at++, 1 };
       break;
     default:
-      if (isupper(*at))
+      if (char_classes[*at] & CHAR_UPPER)
         {
-          do
-            advance_line_info(ctx, *at++);
-          while (isalnum(*at)
-                 || *at == '\''
-                 || *at == '-'
-                 || *at == '_');
+          at = skip_chars(ctx, at + 1, CHAR_VARIABLE);
 
           token.type = Token::Variable;
           token.text = { token.text.data(), size_t(at - token.text.data()) };
         }
       else
         {
-          auto const is_escape_char =
-            [](char ch) -> bool
-            {
-              return isupper(ch)
-                || ch == ':'
-                || ch == ';'
-                || ch == '|'
-                || ch == ' ';
-            };
-
-          while (*at != '\0' && !is_escape_char(*at))
+          do
             {
-              if (*at == '\\')
+              at = skip_other_chars(ctx, at, CHAR_ENDS_TERMINALS | CHAR_BACKSLASH);
+              if (char_at(ctx, at) != '\\')
+                break;
+
+              at++;
+              if (!(char_classes[char_at(ctx, at)] & CHAR_ESCAPABLE))
                 {
-                  advance_line_info(ctx, *at++);
+                  failed_to_tokenize = true;
+                  PRINT_ERROR(locate(ctx, size_t(at - ctx.source)), "invalid escape sequence '\\%c'", char_at(ctx, at));
 
-                  if (*at != '\\' && !is_escape_char(*at))
-                    {
-                      failed_to_tokenize = true;
-                      PRINT_ERROR(ctx.line_info, "invalid escape sequence '\\%c'", *at);
-                    }
+                  if (at == ctx.source_end)
+                    break;
                 }
 
-              advance_line_info(ctx, *at++);
+              at++;
             }
+          while (true);
 
           token.type = Token::Terminals_Sequence;
           token.text = { token.text.data(), size_t(at - token.text.data()) };
@@ -136,61 +214,57 @@ buffer_token_custom(TokenizerContext &ctx)
   if (failed_to_tokenize)
     exit(EXIT_FAILURE);
 
-  assert(ctx.token_count < ctx.LOOKAHEAD);
-  uint8_t index = (ctx.token_start + ctx.token_count) % ctx.LOOKAHEAD;
-  ctx.tokens_buffer[index] = token;
-  ctx.token_count++;
+  push_token(ctx, token, at);
 }
 
 void
 buffer_token_bnf(TokenizerContext &ctx)
 {
   auto failed_to_tokenize = false;
-  auto at = &ctx.source[ctx.line_info.offset];
-  auto has_new_line = false;
-
-  while (isspace(*at))
-    {
-      has_new_line = (*at == '\n') || has_new_line;
-      advance_line_info(ctx, *at++);
-    }
+  auto space = ctx.source + ctx.offset;
+  auto at = skip_chars(ctx, space, CHAR_SPACE);
 
   auto token = Token{
     .type = Token::End_Of_File,
     .text = { at, 0 },
-    .line_info = ctx.line_info,
+    .offset = size_t(at - ctx.source),
   };
 
-  if (has_new_line)
+  if (memchr(space, '\n', size_t(at - space)))
     {
       token.type = Token::Delimiter;
-      goto push_token;
+      push_token(ctx, token, at);
+      return;
     }
 
-  switch (*at)
+  switch (char_at(ctx, at))
     {
     case '\0':
+      if (at < ctx.source_end)
+        {
+          failed_to_tokenize = true;
+          PRINT_ERROR0(locate(ctx, token.offset), "unexpected null character");
+        }
+
       break;
     case '<':
       {
-        do
-          advance_line_info(ctx, *at++);
-        while (*at != '\0' && *at != '>');
+        at++;
+        while (char_at(ctx, at) != '\0' && *at != '>')
+          at++;
 
-        if (*at != '>')
+        if (char_at(ctx, at) != '>')
           {
-            failed_to_tokenize = true;
-            PRINT_ERROR0(ctx.line_info, "expected '>' to terminate variable name");
+            PRINT_ERROR0(locate(ctx, size_t(at - ctx.source)), "expected '>' to terminate variable name");
             exit(EXIT_FAILURE);
           }
 
-        advance_line_info(ctx, *at++);
+        at++;
 
         size_t size = size_t(at - token.text.data());
         if (size <= 2)
           {
-            failed_to_tokenize = true;
-            PRINT_ERROR0(ctx.line_info, "empty variable name");
+            PRINT_ERROR0(locate(ctx, size_t(at - ctx.source)), "empty variable name");
             exit(EXIT_FAILURE);
           }
 
@@ -201,55 +275,49 @@ buffer_token_bnf(TokenizerContext &ctx)
       break;
     case '|':
       {
-        advance_line_info(ctx, *at++);
         token.type = Token::Bar;
-        token.text = { token.text.data(), 1 };
+        token.text = { at++, 1 };
       }
 
       break;
     default:
-      if (at[0] == ':' && at[1] == ':' && at[2] == '=')
+      if (char_at(ctx, at) == ':' && char_at(ctx, at + 1) == ':' && char_at(ctx, at + 2) == '=')
         {
           token.type = Token::Define;
-          token.text = { token.text.data(), 3 };
-
+          token.text = { at, 3 };
           at += token.text.size();
-          advance_line_info_assume_no_new_line(ctx, token.text.size());
         }
       else if (*at == '\"')
         {
-          auto const is_escape_char =
-            [](char ch) -> bool
-            {
-              return ch == '\"';
-            };
+          at++;
 
-          advance_line_info(ctx, *at++);
-
-          while (*at != '\0' && *at != '\"')
+          do
             {
-              if (*at == '\\')
+              at = skip_other_chars(ctx, at, CHAR_SPECIAL_BNF);
+              if (char_at(ctx, at) != '\\')
+                break;
+
+              at++;
+              if (!(char_classes[char_at(ctx, at)] & CHAR_ESCAPABLE_BNF))
                 {
-                  advance_line_info(ctx, *at++);
+                  failed_to_tokenize = true;
+                  PRINT_ERROR(locate(ctx, size_t(at - ctx.source)), "invalid escape sequence '\\%c'", char_at(ctx, at));
 
-                  if (*at != '\\' && !is_escape_char(*at))
-                    {
-                      failed_to_tokenize = true;
-                      PRINT_ERROR(ctx.line_info, "invalid escape sequence '\\%c'", *at);
-                    }
+                  if (at == ctx.source_end)
+                    break;
                 }
 
-              advance_line_info(ctx, *at++);
+              at++;
             }
+          while (true);
 
-          if (*at != '\"')
+          if (char_at(ctx, at) != '\"')
             {
-              failed_to_tokenize = true;
-              PRINT_ERROR0(ctx.line_info, "expected '\"' to terminate string");
+              PRINT_ERROR0(locate(ctx, size_t(at - ctx.source)), "expected '\"' to terminate string");
               exit(EXIT_FAILURE);
             }
 
-          advance_line_info(ctx, *at++);
+          at++;
 
           token.type = Token::Terminals_Sequence;
           token.text = { token.text.data() + 1, size_t(at - token.text.data()) - 2 };
@@ -257,29 +325,29 @@ buffer_token_bnf(TokenizerContext &ctx)
       else
         {
           failed_to_tokenize = true;
-          PRINT_ERROR(ctx.line_info, "expected '<' or '\"', but got '%c'", *at);
-
-          while (*at != '\0' && *at != '<' && *at != '\"')
-            advance_line_info(ctx, *at++);
+          PRINT_ERROR(locate(ctx, token.offset), "expected '<' or '\"', but got '%c'", *at);
         }
     }
 
   if (failed_to_tokenize)
     exit(EXIT_FAILURE);
 
- push_token:
-  assert(ctx.token_count < ctx.LOOKAHEAD);
-  uint8_t index = (ctx.token_start + ctx.token_count) % ctx.LOOKAHEAD;
-  ctx.tokens_buffer[index] = token;
-  ctx.token_count++;
+  push_token(ctx, token, at);
 }
 
-using TokenizerBufferTokenFunction = void (*)(TokenizerContext &);
-
+// Tokens are read on demand, at most 'TokenizerContext::LOOKAHEAD' of them ahead.
 struct Tokenizer
 {
   TokenizerContext ctx;
-  TokenizerBufferTokenFunction buffer_token;
+  bool use_bnf;
+
+  void buffer_token()
+  {
+    if (use_bnf)
+      buffer_token_bnf(ctx);
+    else
+      buffer_token_custom(ctx);
+  }
 
   Token grab()
   {
@@ -287,10 +355,15 @@ struct Tokenizer
     return ctx.tokens_buffer[ctx.token_start];
   }
 
+  LineInfo locate(const Token &token) const
+  {
+    return ::locate(ctx, token.offset);
+  }
+
   Token::Type peek()
   {
     if (ctx.token_count == 0)
-      buffer_token(ctx);
+      buffer_token();
 
     return ctx.tokens_buffer[ctx.token_start].type;
   }
@@ -300,7 +373,7 @@ struct Tokenizer
     assert(index < ctx.LOOKAHEAD);
 
     while (index >= ctx.token_count)
-      buffer_token(ctx);
+      buffer_token();
 
     return ctx.tokens_buffer[(ctx.token_start + index) % ctx.LOOKAHEAD].type;
   }
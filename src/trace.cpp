@@ -0,0 +1,200 @@
+constexpr char TRACE_MAGIC[8] = { 'L', 'R', 'T', 'R', 'A', 'C', 'E', '\0' };
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+// Kind of a step in binary trace, stored in the low 'TRACE_STEP_BITS' bits of the step.
+enum TraceStep
+  {
+    Trace_Shift,
+    Trace_Reduce,
+    Trace_Finish,
+  };
+
+constexpr uint32_t TRACE_STEP_BITS = 2;
+
+// Appends 'value' in LEB128: 7 bits per byte starting from the lowest ones, the highest bit is set in every byte except the last one.
+void
+append_varint(std::string &result, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      result.push_back(char(value | 0x80));
+      value >>= 7;
+    }
+
+  result.push_back(char(value));
+}
+
+// Appends 'string' as JSON string. Bytes that aren't printable ASCII are escaped as code points of the same value.
+void
+append_json_string(std::string &result, std::string_view string)
+{
+  result.push_back('"');
+
+  for (auto c: string)
+    {
+      auto byte = (unsigned char)c;
+
+      if (byte == '"' || byte == '\\')
+        {
+          result.push_back('\\');
+          result.push_back(c);
+        }
+      else if (byte < 0x20 || byte >= 0x7f)
+        {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+          result.append(escaped);
+        }
+      else
+        result.push_back(c);
+    }
+
+  result.push_back('"');
+}
+
+// Writes steps of 'TableMatcher' while it matches, so tracing doesn't repeat the match, and only one buffer of steps is kept in memory. Every input from 'reset' to 'finish' of the matcher is one trace, and traces of all inputs are written to the same file in order.
+//
+// JSON trace is one line with an object per step. Binary trace is a sequence of varints, each one is a step with its kind in the low bits and its value in the rest: number of consecutive shifts, rule id of a reduction, or 1 for finish of accepted input and 0 for rejected one. Binary file starts with 'TRACE_MAGIC' and 'TRACE_VERSION' as varint.
+struct TraceWriter
+{
+  const CompiledTable *table;
+  bool is_binary = false;
+
+  std::ofstream file = { };
+  std::string buffer = { };
+  uint64_t pending_shifts = 0;  // Shifts of binary trace that aren't written yet, to merge consecutive ones.
+  bool is_first_step = true;
+
+  void open(const char *filepath)
+  {
+    assert(table);
+
+    file.open(filepath, is_binary ? std::ofstream::binary | std::ofstream::trunc : std::ofstream::trunc);
+    if (!file.is_open())
+      {
+        std::cerr << "error: failed to open '"
+                  << filepath
+                  << "'\n";
+        exit(EXIT_FAILURE);
+      }
+
+    buffer.clear();
+    if (is_binary)
+      {
+        buffer.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        append_varint(buffer, TRACE_VERSION);
+      }
+  }
+
+  void close()
+  {
+    file.write(buffer.data(), std::streamsize(buffer.size()));
+    buffer.clear();
+    file.close();
+  }
+
+  // Writers that aren't opened keep all steps in 'buffer', so that traces made on several threads can be joined in order with 'append_traces'.
+  void flush_if_full()
+  {
+    if (buffer.size() < TRACE_BUFFER_SIZE || !file.is_open())
+      return;
+
+    file.write(buffer.data(), std::streamsize(buffer.size()));
+    buffer.clear();
+  }
+
+  // Appends complete traces from 'buffer' of another writer.
+  void append_traces(std::string_view traces)
+  {
+    buffer.append(traces);
+    flush_if_full();
+  }
+
+  void append_step(TraceStep step, uint64_t value)
+  {
+    if (pending_shifts > 0)
+      {
+        append_varint(buffer, pending_shifts << TRACE_STEP_BITS | Trace_Shift);
+        pending_shifts = 0;
+      }
+
+    append_varint(buffer, value << TRACE_STEP_BITS | step);
+    flush_if_full();
+  }
+
+  void begin_json_step()
+  {
+    if (!is_first_step)
+      buffer.append(", ");
+
+    is_first_step = false;
+  }
+
+  void clear()
+  {
+    is_first_step = true;
+    pending_shifts = 0;
+
+    if (!is_binary)
+      buffer.append("{ \"actions\": [");
+  }
+
+  void shift(unsigned char)
+  {
+    if (is_binary)
+      {
+        pending_shifts++;
+        return;
+      }
+
+    begin_json_step();
+    buffer.append("{ \"type\": \"shift\" }");
+    flush_if_full();
+  }
+
+  void shift(const char *bytes, size_t count)
+  {
+    if (is_binary)
+      pending_shifts += count;
+    else
+      {
+        for (size_t i = 0; i < count; i++)
+          shift((unsigned char)bytes[i]);
+      }
+  }
+
+  void reduce(RuleId rule, SymbolType variable, uint32_t length)
+  {
+    if (is_binary)
+      {
+        append_step(Trace_Reduce, rule);
+        return;
+      }
+
+    auto name = table->variable_name(variable);
+
+    begin_json_step();
+    buffer.append("{ \"type\": \"reduce\", \"rule\": ");
+    buffer.append(std::to_string(rule));
+    buffer.append(", \"to\": { \"symbol\": ");
+    append_json_string(buffer, name);
+    buffer.append(", \"size\": ");
+    buffer.append(std::to_string(length));
+    buffer.append(" } }");
+    flush_if_full();
+  }
+
+  void finish(bool is_accepted)
+  {
+    if (is_binary)
+      {
+        append_step(Trace_Finish, is_accepted);
+        return;
+      }
+
+    begin_json_step();
+    buffer.append(is_accepted ? "{ \"type\": \"finish\", \"result\": 1 }] }\n" : "{ \"type\": \"finish\", \"result\": 0 }] }\n");
+    flush_if_full();
+  }
+};